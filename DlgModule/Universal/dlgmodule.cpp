@@ -24,8 +24,18 @@
  
 */
 
+#include <condition_variable>
+#include <initializer_list>
+#include <functional>
 #include <thread>
 #include <string>
+#include <deque>
+#include <mutex>
+#include <cmath>
+#include <vector>
+#include <cstring>
+#include <cstdio>
+#include <memory>
 
 #include "dlgmodule.h"
 
@@ -90,209 +100,391 @@ EXPORTED_FUNCTION void RegisterCallbacks(char *arg1, char *arg2, char *arg3, cha
 namespace {
 
 unsigned dialog_identifier = 100;
-bool enable_dialog_creation = true;
 void(*CreateAsynEventWithDSMap)(int, int);
 int(*CreateDsMap)(int _num, ...);
 bool(*DsMapAddDouble)(int _index, char *_pKey, double value);
 bool(*DsMapAddString)(int _index, char *_pKey, char *pVal);
 
-std::string arg1;
-std::string arg2;
-std::string arg3;
-std::string arg4;
+enum {
+  dialog_result_none,
+  dialog_result_value,
+  dialog_result_string,
+  dialog_result_strings
+};
+
+// a finished dialog's answer. numbers are posted under "value" and text under
+// "result"; a multiple file selection keeps the newline joined "result" and
+// also gets "count" plus "result0" onwards, one key per file.
+struct dialog_result {
+  dialog_result(unsigned id, double status, int kind = dialog_result_none, double value = 0, std::string result = std::string()) :
+    id(id), status(status), kind(kind), value(value), result(std::move(result)) { }
+  unsigned id;
+  double status;
+  int kind;
+  double value;
+  std::string result;
+};
+
+// splits the list in place; result was already posted whole, so it is ours.
+void dialog_result_add_list(int resultMap, std::string &list) {
+  char key[32];
+  unsigned count = 0;
+  std::size_t begin = 0;
+  while (begin < list.size()) {
+    std::size_t end = list.find('\n', begin);
+    if (end == std::string::npos) end = list.size();
+    else list[end] = '\0';
+    if (end > begin) {
+      snprintf(key, sizeof(key), "result%u", count++);
+      DsMapAddString(resultMap, key, &list[begin]);
+    }
+    begin = end + 1;
+  }
+  DsMapAddDouble(resultMap, (char *)"count", count);
+}
+
+// the only thread that calls into the runner. it sleeps until a result is
+// posted, then takes every result that finished since its last pass and posts
+// the whole batch, so workers never block on the runner. it is started by the
+// first result and stopped and joined when the library is unloaded; results
+// still pending then are dropped, as the runner may already be gone.
+struct dialog_dispatcher {
+  std::mutex mutex;
+  std::condition_variable wakeup;
+  std::vector<dialog_result> results;
+  std::thread thread;
+  bool stopping = false;
+
+  ~dialog_dispatcher() {
+    {
+      std::lock_guard<std::mutex> guard(mutex);
+      stopping = true;
+    }
+    wakeup.notify_one();
+    if (thread.joinable()) thread.join();
+  }
+
+  void post(dialog_result result) {
+    std::lock_guard<std::mutex> guard(mutex);
+    if (stopping) return;
+    results.push_back(std::move(result));
+    if (!thread.joinable()) thread = std::thread(&dialog_dispatcher::run, this);
+    wakeup.notify_one();
+  }
+
+  void run() {
+    std::vector<dialog_result> batch;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+      wakeup.wait(lock, [this] { return stopping || !results.empty(); });
+      if (stopping) return;
+      batch.swap(results);
+      lock.unlock();
+      for (dialog_result &result : batch) {
+        int resultMap = CreateDsMap(0);
+        DsMapAddDouble(resultMap, (char *)"id", result.id);
+        DsMapAddDouble(resultMap, (char *)"status", result.status);
+        if (result.kind == dialog_result_value) {
+          DsMapAddDouble(resultMap, (char *)"value", result.value);
+        } else if (result.kind != dialog_result_none) {
+          DsMapAddString(resultMap, (char *)"result", (char *)result.result.c_str());
+          if (result.kind == dialog_result_strings)
+            dialog_result_add_list(resultMap, result.result);
+        }
+        CreateAsynEventWithDSMap(resultMap, 63);
+      }
+      batch.clear();
+      lock.lock();
+    }
+  }
+};
+
+#if defined(_WIN32)
+// FreeLibrary runs static destructors under the loader lock, which the thread
+// needs in order to exit, so joining it there would deadlock. on windows the
+// dispatcher is never destroyed and its thread ends with the process instead.
+dialog_dispatcher &dispatcher = *new dialog_dispatcher;
+#else
+dialog_dispatcher dispatcher;
+#endif
+
+void dialog_post(dialog_result result) {
+  dispatcher.post(std::move(result));
+}
 
 void show_message_threaded(char *str, unsigned id) {
   double result = show_message(str);
-  int resultMap = CreateDsMap(0);
-  DsMapAddDouble(resultMap, (char *)"id", id);
-  DsMapAddDouble(resultMap, (char *)"status", result);
-  CreateAsynEventWithDSMap(resultMap, 63);
-  enable_dialog_creation = true;
+  dialog_post({ id, result });
 }
 
 void show_message_cancelable_threaded(char *str, unsigned id) {
   double result = show_message_cancelable(str);
-  int resultMap = CreateDsMap(0);
-  DsMapAddDouble(resultMap, (char *)"id", id);
-  DsMapAddDouble(resultMap, (char *)"status", result);
-  CreateAsynEventWithDSMap(resultMap, 63);
-  enable_dialog_creation = true;
+  dialog_post({ id, result });
 }
 
 void show_question_threaded(char *str, unsigned id) {
   double result = show_question(str);
-  int resultMap = CreateDsMap(0);
-  DsMapAddDouble(resultMap, (char *)"id", id);
-  DsMapAddDouble(resultMap, (char *)"status", result);
-  CreateAsynEventWithDSMap(resultMap, 63);
-  enable_dialog_creation = true;
+  dialog_post({ id, result });
 }
 
 void show_question_cancelable_threaded(char *str, unsigned id) {
   double result = show_question_cancelable(str);
-  int resultMap = CreateDsMap(0);
-  DsMapAddDouble(resultMap, (char *)"id", id);
-  DsMapAddDouble(resultMap, (char *)"status", result);
-  CreateAsynEventWithDSMap(resultMap, 63);
-  enable_dialog_creation = true;
+  dialog_post({ id, result });
 }
 
 void show_attempt_threaded(char *str, unsigned id) {
   double result = show_attempt(str);
-  int resultMap = CreateDsMap(0);
-  DsMapAddDouble(resultMap, (char *)"id", id);
-  DsMapAddDouble(resultMap, (char *)"status", result);
-  CreateAsynEventWithDSMap(resultMap, 63);
-  enable_dialog_creation = true;
+  dialog_post({ id, result });
 }
 
 void show_error_threaded(char *str, double abort, unsigned id) {
   double result = show_error(str, abort);
-  int resultMap = CreateDsMap(0);
-  DsMapAddDouble(resultMap, (char *)"id", id);
-  DsMapAddDouble(resultMap, (char *)"status", result);
-  CreateAsynEventWithDSMap(resultMap, 63);
-  enable_dialog_creation = true;
+  dialog_post({ id, result });
 }
 
 void get_string_threaded(char *str, char *def, unsigned id) {
   char *result = get_string(str, def);
-  int resultMap = CreateDsMap(0);
-  DsMapAddDouble(resultMap, (char *)"id", id);
-  DsMapAddDouble(resultMap, (char *)"status", 1);
-  DsMapAddString(resultMap, (char *)"result", result);
-  CreateAsynEventWithDSMap(resultMap, 63);
-  enable_dialog_creation = true;
+  dialog_post({ id, 1, dialog_result_string, 0, result });
 }
 
 void get_password_threaded(char *str, char *def, unsigned id) {
   char *result = get_password(str, def);
-  int resultMap = CreateDsMap(0);
-  DsMapAddDouble(resultMap, (char *)"id", id);
-  DsMapAddDouble(resultMap, (char *)"status", 1);
-  DsMapAddString(resultMap, (char *)"result", result);
-  CreateAsynEventWithDSMap(resultMap, 63);
-  enable_dialog_creation = true;
+  dialog_post({ id, 1, dialog_result_string, 0, result });
 }
 
 void get_integer_threaded(char *str, double def, unsigned id) {
   double result = get_integer(str, def);
-  int resultMap = CreateDsMap(0);
-  DsMapAddDouble(resultMap, (char *)"id", id);
-  DsMapAddDouble(resultMap, (char *)"status", isnan(result) ? 0 : 1);
-  DsMapAddDouble(resultMap, (char *)"value", isnan(result) ? 0 : result);
-  CreateAsynEventWithDSMap(resultMap, 63);
-  enable_dialog_creation = true;
+  dialog_post({ id, std::isnan(result) ? 0.0 : 1.0, dialog_result_value, std::isnan(result) ? 0 : result });
 }
 
 void get_passcode_threaded(char *str, double def, unsigned id) {
   double result = get_passcode(str, def);
-  int resultMap = CreateDsMap(0);
-  DsMapAddDouble(resultMap, (char *)"id", id);
-  DsMapAddDouble(resultMap, (char *)"status", 1);
-  DsMapAddDouble(resultMap, (char *)"value", result);
-  CreateAsynEventWithDSMap(resultMap, 63);
-  enable_dialog_creation = true;
+  dialog_post({ id, 1, dialog_result_value, result });
 }
 
 void get_open_filename_threaded(char *filter, char *fname, unsigned id) {
   char *result = get_open_filename(filter, fname);
-  int resultMap = CreateDsMap(0);
-  DsMapAddDouble(resultMap, (char *)"id", id);
-  DsMapAddDouble(resultMap, (char *)"status", 1);
-  DsMapAddString(resultMap, (char *)"result", result);
-  CreateAsynEventWithDSMap(resultMap, 63);
-  enable_dialog_creation = true;
+  dialog_post({ id, 1, dialog_result_string, 0, result });
 }
 
 void get_open_filename_ext_threaded(char *filter, char *fname, char *dir, char *title, unsigned id) {
   char *result = get_open_filename_ext(filter, fname, dir, title);
-  int resultMap = CreateDsMap(0);
-  DsMapAddDouble(resultMap, (char *)"id", id);
-  DsMapAddDouble(resultMap, (char *)"status", 1);
-  DsMapAddString(resultMap, (char *)"result", result);
-  CreateAsynEventWithDSMap(resultMap, 63);
-  enable_dialog_creation = true;
+  dialog_post({ id, 1, dialog_result_string, 0, result });
 }
 
 void get_open_filenames_threaded(char *filter, char *fname, unsigned id) {
   char *result = get_open_filenames(filter, fname);
-  int resultMap = CreateDsMap(0);
-  DsMapAddDouble(resultMap, (char *)"id", id);
-  DsMapAddDouble(resultMap, (char *)"status", 1);
-  DsMapAddString(resultMap, (char *)"result", result);
-  CreateAsynEventWithDSMap(resultMap, 63);
-  enable_dialog_creation = true;
+  dialog_post({ id, 1, dialog_result_strings, 0, result });
 }
 
 void get_open_filenames_ext_threaded(char *filter, char *fname, char *dir, char *title, unsigned id) {
   char *result = get_open_filenames_ext(filter, fname, dir, title);
-  int resultMap = CreateDsMap(0);
-  DsMapAddDouble(resultMap, (char *)"id", id);
-  DsMapAddDouble(resultMap, (char *)"status", 1);
-  DsMapAddString(resultMap, (char *)"result", result);
-  CreateAsynEventWithDSMap(resultMap, 63);
-  enable_dialog_creation = true;
+  dialog_post({ id, 1, dialog_result_strings, 0, result });
 }
 
 void get_save_filename_threaded(char *filter, char *fname, unsigned id) {
   char *result = get_save_filename(filter, fname);
-  int resultMap = CreateDsMap(0);
-  DsMapAddDouble(resultMap, (char *)"id", id);
-  DsMapAddDouble(resultMap, (char *)"status", 1);
-  DsMapAddString(resultMap, (char *)"result", result);
-  CreateAsynEventWithDSMap(resultMap, 63);
-  enable_dialog_creation = true;
+  dialog_post({ id, 1, dialog_result_string, 0, result });
 }
 
 void get_save_filename_ext_threaded(char *filter, char *fname, char *dir, char *title, unsigned id) {
   char *result = get_save_filename_ext(filter, fname, dir, title);
-  int resultMap = CreateDsMap(0);
-  DsMapAddDouble(resultMap, (char *)"id", id);
-  DsMapAddDouble(resultMap, (char *)"status", 1);
-  DsMapAddString(resultMap, (char *)"result", result);
-  CreateAsynEventWithDSMap(resultMap, 63);
-  enable_dialog_creation = true;
+  dialog_post({ id, 1, dialog_result_string, 0, result });
 }
 
 void get_directory_threaded(char *dname, unsigned id) {
   char *result = get_directory(dname);
-  int resultMap = CreateDsMap(0);
-  DsMapAddDouble(resultMap, (char *)"id", id);
-  DsMapAddDouble(resultMap, (char *)"status", 1);
-  DsMapAddString(resultMap, (char *)"result", result);
-  CreateAsynEventWithDSMap(resultMap, 63);
-  enable_dialog_creation = true;
+  dialog_post({ id, 1, dialog_result_string, 0, result });
 }
 
 void get_directory_alt_threaded(char *capt, char *root, unsigned id) {
   char *result = get_directory_alt(capt, root);
-  int resultMap = CreateDsMap(0);
-  DsMapAddDouble(resultMap, (char *)"id", id);
-  DsMapAddDouble(resultMap, (char *)"status", 1);
-  DsMapAddString(resultMap, (char *)"result", result);
-  CreateAsynEventWithDSMap(resultMap, 63);
-  enable_dialog_creation = true;
+  dialog_post({ id, 1, dialog_result_string, 0, result });
 }
 
 void get_color_threaded(double defcol, unsigned id) {
   double result = get_color(defcol);
-  int resultMap = CreateDsMap(0);
-  DsMapAddDouble(resultMap, (char *)"id", id);
-  DsMapAddDouble(resultMap, (char *)"status", 1);
-  DsMapAddDouble(resultMap, (char *)"value", result);
-  CreateAsynEventWithDSMap(resultMap, 63);
-  enable_dialog_creation = true;
+  dialog_post({ id, 1, dialog_result_value, result });
 }
 
 void get_color_ext_threaded(double defcol, char *title, unsigned id) {
   double result = get_color_ext(defcol, title);
-  int resultMap = CreateDsMap(0);
-  DsMapAddDouble(resultMap, (char *)"id", id);
-  DsMapAddDouble(resultMap, (char *)"status", 1);
-  DsMapAddDouble(resultMap, (char *)"value", result);
-  CreateAsynEventWithDSMap(resultMap, 63);
-  enable_dialog_creation = true;
+  dialog_post({ id, 1, dialog_result_value, result });
+}
+
+enum { widget_button_count = 7 };
+
+// the owner window, caption, icon, dialog engine and button names. every
+// backend keeps these in globals that an open dialog keeps reading, so the
+// game's copy is kept here, each async request takes its own when queued, and
+// the backend's are only touched under widget_mutex.
+struct widget_settings {
+  std::string owner;
+  std::string caption;
+  std::string icon;
+  std::string system;
+  std::string button_name[widget_button_count];
+};
+
+std::mutex widget_mutex;
+widget_settings widget_current;
+bool widget_loaded = false;
+bool widget_busy = false;
+
+// the backend fills in its own defaults, so the game's copy starts from them.
+void widget_load_locked() {
+  if (widget_loaded) return;
+  widget_current.owner = dialog_module::widget_get_owner();
+  widget_current.caption = dialog_module::widget_get_caption();
+  widget_current.icon = dialog_module::widget_get_icon();
+  widget_current.system = dialog_module::widget_get_system();
+  for (int i = 0; i < widget_button_count; i++)
+    widget_current.button_name[i] = dialog_module::widget_get_button_name(i);
+  widget_loaded = true;
+}
+
+// only writes what differs from the backend, as the mac backend rewrites a
+// file for every button name it is given. given the settings a dialog was just
+// shown with, it also skips those the game has not changed since, so what the
+// backend picked for itself meanwhile, such as its dialog engine, stays.
+bool widget_setting_changed(const std::string &setting, const std::string *shown, const char *held) {
+  return (!shown || setting != *shown) && setting != held;
+}
+
+void widget_apply_locked(const widget_settings &settings, const widget_settings *shown = nullptr) {
+  if (widget_setting_changed(settings.owner, shown ? &shown->owner : nullptr, dialog_module::widget_get_owner()))
+    dialog_module::widget_set_owner((char *)settings.owner.c_str());
+  if (widget_setting_changed(settings.caption, shown ? &shown->caption : nullptr, dialog_module::widget_get_caption()))
+    dialog_module::widget_set_caption((char *)settings.caption.c_str());
+  if (widget_setting_changed(settings.icon, shown ? &shown->icon : nullptr, dialog_module::widget_get_icon()))
+    dialog_module::widget_set_icon((char *)settings.icon.c_str());
+  if (widget_setting_changed(settings.system, shown ? &shown->system : nullptr, dialog_module::widget_get_system()))
+    dialog_module::widget_set_system((char *)settings.system.c_str());
+  for (int i = 0; i < widget_button_count; i++) {
+    if (widget_setting_changed(settings.button_name[i], shown ? &shown->button_name[i] : nullptr, dialog_module::widget_get_button_name(i)))
+      dialog_module::widget_set_button_name(i, (char *)settings.button_name[i].c_str());
+  }
+}
+
+// while an async dialog is open the backend holds that request's settings, so
+// the game's copy answers for it and reaches the backend once the dialog
+// closes. otherwise the backend is the source, as it may normalize a setting,
+// such as making the icon path absolute, or pick the dialog engine itself.
+char *widget_get_locked(std::string &setting, char *(*get)()) {
+  widget_load_locked();
+  if (!widget_busy) setting = get();
+  return (char *)setting.c_str();
+}
+
+void widget_set_locked(std::string &setting, const char *value, void(*set)(char *), char *(*get)()) {
+  widget_load_locked();
+  setting = value ? value : "";
+  if (widget_busy) return;
+  set((char *)setting.c_str());
+  setting = get();
+}
+
+// the strings of one request packed back to back in a single buffer, plus the
+// widget settings it was made with. buffers go back on a freelist with their
+// capacity once the result is posted, so bursts of requests stop allocating
+// after warming up.
+struct dialog_arguments {
+  std::vector<char> buffer;
+  std::size_t offset[4];
+  widget_settings settings;
+  char *argument(int i) { return buffer.data() + offset[i]; }
+};
+
+std::mutex dialog_arguments_mutex;
+std::vector<std::unique_ptr<dialog_arguments>> dialog_arguments_free;
+
+dialog_arguments *dialog_arguments_acquire(std::initializer_list<const char *> strings) {
+  dialog_arguments *arguments = nullptr;
+  {
+    std::lock_guard<std::mutex> guard(dialog_arguments_mutex);
+    if (!dialog_arguments_free.empty()) {
+      arguments = dialog_arguments_free.back().release();
+      dialog_arguments_free.pop_back();
+    }
+  }
+  if (!arguments) arguments = new dialog_arguments();
+  {
+    std::lock_guard<std::mutex> guard(widget_mutex);
+    widget_load_locked();
+    arguments->settings = widget_current;
+  }
+  const char *source[4];
+  std::size_t length[4], total = 0;
+  int count = 0;
+  for (const char *str : strings) source[count++] = str ? str : "";
+  for (int i = 0; i < count; i++) {
+    length[i] = strlen(source[i]) + 1;
+    total += length[i];
+  }
+  arguments->buffer.resize(total);
+  std::size_t offset = 0;
+  for (int i = 0; i < count; offset += length[i++]) {
+    arguments->offset[i] = offset;
+    memcpy(arguments->buffer.data() + offset, source[i], length[i]);
+  }
+  return arguments;
+}
+
+void dialog_arguments_release(dialog_arguments *arguments) {
+  std::lock_guard<std::mutex> guard(dialog_arguments_mutex);
+  dialog_arguments_free.emplace_back(arguments);
+}
+
+// a queued *_async call. the show callback hands the result to the dispatcher
+// before the next request starts, so results arrive in request order. the
+// backend shows it with the settings it was made with, then gets the game's
+// current ones back.
+struct dialog_request {
+  unsigned id;
+  dialog_arguments *arguments;
+  std::function<void(unsigned)> show;
+};
+
+std::mutex dialog_mutex;
+std::deque<dialog_request> dialog_queue;
+bool dialog_running = false;
+
+void dialog_worker(dialog_request request);
+
+// starts the oldest queued request once the previous one is done. the
+// backends keep their widget settings and results in globals, so only one
+// dialog may be open at a time.
+void dialog_dispatch_locked() {
+  if (dialog_running || dialog_queue.empty()) return;
+  dialog_running = true;
+  std::thread(dialog_worker, std::move(dialog_queue.front())).detach();
+  dialog_queue.pop_front();
+}
+
+void dialog_worker(dialog_request request) {
+  {
+    std::lock_guard<std::mutex> guard(widget_mutex);
+    widget_apply_locked(request.arguments->settings);
+    widget_busy = true;
+  }
+  request.show(request.id);
+  {
+    std::lock_guard<std::mutex> guard(widget_mutex);
+    widget_busy = false;
+    widget_apply_locked(widget_current, &request.arguments->settings);
+  }
+  dialog_arguments_release(request.arguments);
+  std::lock_guard<std::mutex> guard(dialog_mutex);
+  dialog_running = false;
+  dialog_dispatch_locked();
+}
+
+double dialog_enqueue(dialog_arguments *arguments, std::function<void(unsigned)> show) {
+  std::lock_guard<std::mutex> guard(dialog_mutex);
+  unsigned id = dialog_identifier++;
+  dialog_queue.push_back({ id, arguments, std::move(show) });
+  dialog_dispatch_locked();
+  return (double)id;
 }
 
 } // anonymous namespace
@@ -302,15 +494,10 @@ double show_message(char *str) {
 }
 
 double show_message_async(char *str) {
-  if (enable_dialog_creation) {
-    enable_dialog_creation = false;
-    unsigned id = dialog_identifier++;
-    arg1 = str;
-    std::thread dialog_thread(show_message_threaded, (char *)arg1.c_str(), id);
-    dialog_thread.detach();
-    return (double)id;
-  }
-  return dialog_identifier - 1;
+  dialog_arguments *arguments = dialog_arguments_acquire({ str });
+  return dialog_enqueue(arguments, [arguments](unsigned id) {
+    show_message_threaded(arguments->argument(0), id);
+  });
 }
 
 double show_message_cancelable(char *str) {
@@ -318,15 +505,10 @@ double show_message_cancelable(char *str) {
 }
 
 double show_message_cancelable_async(char *str) {
-  if (enable_dialog_creation) {
-    enable_dialog_creation = false;
-    unsigned id = dialog_identifier++;
-    arg1 = str;
-    std::thread dialog_thread(show_message_cancelable_threaded, (char *)arg1.c_str(), id);
-    dialog_thread.detach();
-    return (double)id;
-  }
-  return dialog_identifier - 1;
+  dialog_arguments *arguments = dialog_arguments_acquire({ str });
+  return dialog_enqueue(arguments, [arguments](unsigned id) {
+    show_message_cancelable_threaded(arguments->argument(0), id);
+  });
 }
 
 double show_question(char *str) {
@@ -334,15 +516,10 @@ double show_question(char *str) {
 }
 
 double show_question_async(char *str) {
-  if (enable_dialog_creation) {
-    enable_dialog_creation = false;
-    unsigned id = dialog_identifier++;
-    arg1 = str;
-    std::thread dialog_thread(show_question_threaded, (char *)arg1.c_str(), id);
-    dialog_thread.detach();
-    return (double)id;
-  }
-  return dialog_identifier - 1;
+  dialog_arguments *arguments = dialog_arguments_acquire({ str });
+  return dialog_enqueue(arguments, [arguments](unsigned id) {
+    show_question_threaded(arguments->argument(0), id);
+  });
 }
 
 double show_question_cancelable(char *str) {
@@ -350,15 +527,10 @@ double show_question_cancelable(char *str) {
 }
 
 double show_question_cancelable_async(char *str) {
-  if (enable_dialog_creation) {
-    enable_dialog_creation = false;
-    unsigned id = dialog_identifier++;
-    arg1 = str;
-    std::thread dialog_thread(show_question_cancelable_threaded, (char *)arg1.c_str(), id);
-    dialog_thread.detach();
-    return (double)id;
-  }
-  return dialog_identifier - 1;
+  dialog_arguments *arguments = dialog_arguments_acquire({ str });
+  return dialog_enqueue(arguments, [arguments](unsigned id) {
+    show_question_cancelable_threaded(arguments->argument(0), id);
+  });
 }
 
 double show_attempt(char *str) {
@@ -366,15 +538,10 @@ double show_attempt(char *str) {
 }
 
 double show_attempt_async(char *str) {
-  if (enable_dialog_creation) {
-    enable_dialog_creation = false;
-    unsigned id = dialog_identifier++;
-    arg1 = str;
-    std::thread dialog_thread(show_attempt_threaded, (char *)arg1.c_str(), id);
-    dialog_thread.detach();
-    return (double)id;
-  }
-  return dialog_identifier - 1;
+  dialog_arguments *arguments = dialog_arguments_acquire({ str });
+  return dialog_enqueue(arguments, [arguments](unsigned id) {
+    show_attempt_threaded(arguments->argument(0), id);
+  });
 }
 
 double show_error(char *str, double abort) {
@@ -382,15 +549,10 @@ double show_error(char *str, double abort) {
 }
 
 double show_error_async(char *str, double abort) {
-  if (enable_dialog_creation) {
-    enable_dialog_creation = false;
-    unsigned id = dialog_identifier++;
-    arg1 = str;
-    std::thread dialog_thread(show_error_threaded, (char *)arg1.c_str(), abort, id);
-    dialog_thread.detach();
-    return (double)id;
-  }
-  return dialog_identifier - 1;
+  dialog_arguments *arguments = dialog_arguments_acquire({ str });
+  return dialog_enqueue(arguments, [arguments, abort](unsigned id) {
+    show_error_threaded(arguments->argument(0), abort, id);
+  });
 }
 
 char *get_string(char *str, char *def) {
@@ -398,16 +560,10 @@ char *get_string(char *str, char *def) {
 }
 
 double get_string_async(char *str, char *def) {
-  if (enable_dialog_creation) {
-    enable_dialog_creation = false;
-    unsigned id = dialog_identifier++;
-    arg1 = str;
-    arg2 = def;
-    std::thread dialog_thread(get_string_threaded, (char *)arg1.c_str(), (char *)arg2.c_str(), id);
-    dialog_thread.detach();
-    return (double)id;
-  }
-  return dialog_identifier - 1;
+  dialog_arguments *arguments = dialog_arguments_acquire({ str, def });
+  return dialog_enqueue(arguments, [arguments](unsigned id) {
+    get_string_threaded(arguments->argument(0), arguments->argument(1), id);
+  });
 }
 
 char *get_password(char *str, char *def) {
@@ -415,16 +571,10 @@ char *get_password(char *str, char *def) {
 }
 
 double get_password_async(char *str, char *def) {
-  if (enable_dialog_creation) {
-    enable_dialog_creation = false;
-    unsigned id = dialog_identifier++;
-    arg1 = str;
-    arg2 = def;
-    std::thread dialog_thread(get_password_threaded, (char *)arg1.c_str(), (char *)arg2.c_str(), id);
-    dialog_thread.detach();
-    return (double)id;
-  }
-  return dialog_identifier - 1;
+  dialog_arguments *arguments = dialog_arguments_acquire({ str, def });
+  return dialog_enqueue(arguments, [arguments](unsigned id) {
+    get_password_threaded(arguments->argument(0), arguments->argument(1), id);
+  });
 }
 
 double get_integer(char *str, double def) {
@@ -432,15 +582,10 @@ double get_integer(char *str, double def) {
 }
 
 double get_integer_async(char *str, double def) {
-  if (enable_dialog_creation) {
-    enable_dialog_creation = false;
-    unsigned id = dialog_identifier++;
-    arg1 = str;
-    std::thread dialog_thread(get_integer_threaded, (char *)arg1.c_str(), def, id);
-    dialog_thread.detach();
-    return (double)id;
-  }
-  return dialog_identifier - 1;
+  dialog_arguments *arguments = dialog_arguments_acquire({ str });
+  return dialog_enqueue(arguments, [arguments, def](unsigned id) {
+    get_integer_threaded(arguments->argument(0), def, id);
+  });
 }
 
 double get_passcode(char *str, double def) {
@@ -448,15 +593,10 @@ double get_passcode(char *str, double def) {
 }
 
 double get_passcode_async(char *str, double def) {
-  if (enable_dialog_creation) {
-    enable_dialog_creation = false;
-    unsigned id = dialog_identifier++;
-    arg1 = str;
-    std::thread dialog_thread(get_passcode_threaded, (char *)arg1.c_str(), def, id);
-    dialog_thread.detach();
-    return (double)id;
-  }
-  return dialog_identifier - 1;
+  dialog_arguments *arguments = dialog_arguments_acquire({ str });
+  return dialog_enqueue(arguments, [arguments, def](unsigned id) {
+    get_passcode_threaded(arguments->argument(0), def, id);
+  });
 }
 
 char *get_open_filename(char *filter, char *fname) {
@@ -464,16 +604,10 @@ char *get_open_filename(char *filter, char *fname) {
 }
 
 double get_open_filename_async(char *filter, char *fname) {
-  if (enable_dialog_creation) {
-    enable_dialog_creation = false;
-    unsigned id = dialog_identifier++;
-    arg1 = filter;
-    arg2 = fname;
-    std::thread dialog_thread(get_open_filename_threaded, (char *)arg1.c_str(), (char *)arg2.c_str(), id);
-    dialog_thread.detach();
-    return (double)id;
-  }
-  return dialog_identifier - 1;
+  dialog_arguments *arguments = dialog_arguments_acquire({ filter, fname });
+  return dialog_enqueue(arguments, [arguments](unsigned id) {
+    get_open_filename_threaded(arguments->argument(0), arguments->argument(1), id);
+  });
 }
 
 char *get_open_filename_ext(char *filter, char *fname, char *dir, char *title) {
@@ -481,18 +615,10 @@ char *get_open_filename_ext(char *filter, char *fname, char *dir, char *title) {
 }
 
 double get_open_filename_ext_async(char *filter, char *fname, char *dir, char *title) {
-  if (enable_dialog_creation) {
-    enable_dialog_creation = false;
-    unsigned id = dialog_identifier++;
-    arg1 = filter;
-    arg2 = fname;
-    arg3 = dir;
-    arg4 = title;
-    std::thread dialog_thread(get_open_filename_ext_threaded, (char *)arg1.c_str(), (char *)arg2.c_str(), (char *)arg3.c_str(), (char *)arg4.c_str(), id);
-    dialog_thread.detach();
-    return (double)id;
-  }
-  return dialog_identifier - 1;
+  dialog_arguments *arguments = dialog_arguments_acquire({ filter, fname, dir, title });
+  return dialog_enqueue(arguments, [arguments](unsigned id) {
+    get_open_filename_ext_threaded(arguments->argument(0), arguments->argument(1), arguments->argument(2), arguments->argument(3), id);
+  });
 }
 
 char *get_open_filenames(char *filter, char *fname) {
@@ -500,16 +626,10 @@ char *get_open_filenames(char *filter, char *fname) {
 }
 
 double get_open_filenames_async(char *filter, char *fname) {
-  if (enable_dialog_creation) {
-    enable_dialog_creation = false;
-    unsigned id = dialog_identifier++;
-    arg1 = filter;
-    arg2 = fname;
-    std::thread dialog_thread(get_open_filenames_threaded, (char *)arg1.c_str(), (char *)arg2.c_str(), id);
-    dialog_thread.detach();
-    return (double)id;
-  }
-  return dialog_identifier - 1;
+  dialog_arguments *arguments = dialog_arguments_acquire({ filter, fname });
+  return dialog_enqueue(arguments, [arguments](unsigned id) {
+    get_open_filenames_threaded(arguments->argument(0), arguments->argument(1), id);
+  });
 }
 
 char *get_open_filenames_ext(char *filter, char *fname, char *dir, char *title) {
@@ -517,18 +637,10 @@ char *get_open_filenames_ext(char *filter, char *fname, char *dir, char *title)
 }
 
 double get_open_filenames_ext_async(char *filter, char *fname, char *dir, char *title) {
-  if (enable_dialog_creation) {
-    enable_dialog_creation = false;
-    unsigned id = dialog_identifier++;
-    arg1 = filter;
-    arg2 = fname;
-    arg3 = dir;
-    arg4 = title;
-    std::thread dialog_thread(get_open_filenames_ext_threaded, (char *)arg1.c_str(), (char *)arg2.c_str(), (char *)arg3.c_str(), (char *)arg4.c_str(), id);
-    dialog_thread.detach();
-    return (double)id;
-  }
-  return dialog_identifier - 1;
+  dialog_arguments *arguments = dialog_arguments_acquire({ filter, fname, dir, title });
+  return dialog_enqueue(arguments, [arguments](unsigned id) {
+    get_open_filenames_ext_threaded(arguments->argument(0), arguments->argument(1), arguments->argument(2), arguments->argument(3), id);
+  });
 }
 
 char *get_save_filename(char *filter, char *fname) {
@@ -536,16 +648,10 @@ char *get_save_filename(char *filter, char *fname) {
 }
 
 double get_save_filename_async(char *filter, char *fname) {
-  if (enable_dialog_creation) {
-    enable_dialog_creation = false;
-    unsigned id = dialog_identifier++;
-    arg1 = filter;
-    arg2 = fname;
-    std::thread dialog_thread(get_save_filename_threaded, (char *)arg1.c_str(), (char *)arg2.c_str(), id);
-    dialog_thread.detach();
-    return (double)id;
-  }
-  return dialog_identifier - 1;
+  dialog_arguments *arguments = dialog_arguments_acquire({ filter, fname });
+  return dialog_enqueue(arguments, [arguments](unsigned id) {
+    get_save_filename_threaded(arguments->argument(0), arguments->argument(1), id);
+  });
 }
 
 char *get_save_filename_ext(char *filter, char *fname, char *dir, char *title) {
@@ -553,18 +659,10 @@ char *get_save_filename_ext(char *filter, char *fname, char *dir, char *title) {
 }
 
 double get_save_filename_ext_async(char *filter, char *fname, char *dir, char *title) {
-  if (enable_dialog_creation) {
-    enable_dialog_creation = false;
-    unsigned id = dialog_identifier++;
-    arg1 = filter;
-    arg2 = fname;
-    arg3 = dir;
-    arg4 = title;
-    std::thread dialog_thread(get_save_filename_ext_threaded, (char *)arg1.c_str(), (char *)arg2.c_str(), (char *)arg3.c_str(), (char *)arg4.c_str(), id);
-    dialog_thread.detach();
-    return (double)id;
-  }
-  return dialog_identifier - 1;
+  dialog_arguments *arguments = dialog_arguments_acquire({ filter, fname, dir, title });
+  return dialog_enqueue(arguments, [arguments](unsigned id) {
+    get_save_filename_ext_threaded(arguments->argument(0), arguments->argument(1), arguments->argument(2), arguments->argument(3), id);
+  });
 }
 
 char *get_directory(char *dname) {
@@ -572,15 +670,10 @@ char *get_directory(char *dname) {
 }
 
 double get_directory_async(char *dname) {
-  if (enable_dialog_creation) {
-    enable_dialog_creation = false;
-    unsigned id = dialog_identifier++;
-    arg1 = dname;
-    std::thread dialog_thread(get_directory_threaded, (char *)arg1.c_str(), id);
-    dialog_thread.detach();
-    return (double)id;
-  }
-  return dialog_identifier - 1;
+  dialog_arguments *arguments = dialog_arguments_acquire({ dname });
+  return dialog_enqueue(arguments, [arguments](unsigned id) {
+    get_directory_threaded(arguments->argument(0), id);
+  });
 }
 
 char *get_directory_alt(char *capt, char *root) {
@@ -588,16 +681,10 @@ char *get_directory_alt(char *capt, char *root) {
 }
 
 double get_directory_alt_async(char *capt, char *root) {
-  if (enable_dialog_creation) {
-    enable_dialog_creation = false;
-    unsigned id = dialog_identifier++;
-    arg1 = capt;
-    arg2 = root;
-    std::thread dialog_thread(get_directory_alt_threaded, (char *)arg1.c_str(), (char *)arg2.c_str(), id);
-    dialog_thread.detach();
-    return (double)id;
-  }
-  return dialog_identifier - 1;
+  dialog_arguments *arguments = dialog_arguments_acquire({ capt, root });
+  return dialog_enqueue(arguments, [arguments](unsigned id) {
+    get_directory_alt_threaded(arguments->argument(0), arguments->argument(1), id);
+  });
 }
 
 double get_color(double defcol) {
@@ -605,14 +692,10 @@ double get_color(double defcol) {
 }
 
 double get_color_async(double defcol) {
-  if (enable_dialog_creation) {
-	enable_dialog_creation = false;
-    unsigned id = dialog_identifier++;
-    std::thread dialog_thread(get_color_threaded, (int)defcol, id);
-    dialog_thread.detach();
-    return (double)id;
-  }
-  return dialog_identifier - 1;
+  dialog_arguments *arguments = dialog_arguments_acquire({});
+  return dialog_enqueue(arguments, [arguments, defcol](unsigned id) {
+    get_color_threaded((int)defcol, id);
+  });
 }
 
 double get_color_ext(double defcol, char *title) {
@@ -620,59 +703,75 @@ double get_color_ext(double defcol, char *title) {
 }
 
 double get_color_ext_async(double defcol, char *title) {
-  if (enable_dialog_creation) {
-    enable_dialog_creation = false;
-    unsigned id = dialog_identifier++;
-    arg2 = title;
-    std::thread dialog_thread(get_color_ext_threaded, (int)defcol, (char *)arg2.c_str(), id);
-    dialog_thread.detach();
-    return (double)id;
-  }
-  return dialog_identifier - 1;
+  dialog_arguments *arguments = dialog_arguments_acquire({ title });
+  return dialog_enqueue(arguments, [arguments, defcol](unsigned id) {
+    get_color_ext_threaded((int)defcol, arguments->argument(0), id);
+  });
 }
 
 char *widget_get_caption() {
-  return dialog_module::widget_get_caption();
+  std::lock_guard<std::mutex> guard(widget_mutex);
+  return widget_get_locked(widget_current.caption, dialog_module::widget_get_caption);
 }
 
 double widget_set_caption(char *str) {
-  dialog_module::widget_set_caption(str);
+  std::lock_guard<std::mutex> guard(widget_mutex);
+  widget_set_locked(widget_current.caption, str, dialog_module::widget_set_caption, dialog_module::widget_get_caption);
   return 0;
 }
 
 char *widget_get_icon() {
-  return dialog_module::widget_get_icon();
+  std::lock_guard<std::mutex> guard(widget_mutex);
+  return widget_get_locked(widget_current.icon, dialog_module::widget_get_icon);
 }
 
 double widget_set_icon(char *icon) {
-  dialog_module::widget_set_icon(icon);
+  std::lock_guard<std::mutex> guard(widget_mutex);
+  widget_set_locked(widget_current.icon, icon, dialog_module::widget_set_icon, dialog_module::widget_get_icon);
   return 0;
 }
 
 char *widget_get_owner() {
-  return dialog_module::widget_get_owner();
+  std::lock_guard<std::mutex> guard(widget_mutex);
+  return widget_get_locked(widget_current.owner, dialog_module::widget_get_owner);
 }
 
 double widget_set_owner(char *hwnd) {
-  dialog_module::widget_set_owner(hwnd);
+  std::lock_guard<std::mutex> guard(widget_mutex);
+  widget_set_locked(widget_current.owner, hwnd, dialog_module::widget_set_owner, dialog_module::widget_get_owner);
   return 0;
 }
 
 char *widget_get_system() {
-  return dialog_module::widget_get_system();
+  std::lock_guard<std::mutex> guard(widget_mutex);
+  return widget_get_locked(widget_current.system, dialog_module::widget_get_system);
 }
 
 double widget_set_system(char *sys) {
-  dialog_module::widget_set_system(sys);
+  std::lock_guard<std::mutex> guard(widget_mutex);
+  widget_set_locked(widget_current.system, sys, dialog_module::widget_set_system, dialog_module::widget_get_system);
   return 0;
 }
 
 char *widget_get_button_name(double type) {
-  return dialog_module::widget_get_button_name((int)type);
+  if (type < 0 || type >= widget_button_count) return (char *)"";
+  std::lock_guard<std::mutex> guard(widget_mutex);
+  widget_load_locked();
+  std::string &setting = widget_current.button_name[(int)type];
+  if (!widget_busy) setting = dialog_module::widget_get_button_name((int)type);
+  return (char *)setting.c_str();
 }
 
 double widget_set_button_name(double type, char *name) {
-  dialog_module::widget_set_button_name((int)type, name);
+  if (type < 0 || type >= widget_button_count) return 0;
+  std::lock_guard<std::mutex> guard(widget_mutex);
+  widget_load_locked();
+  std::string &setting = widget_current.button_name[(int)type];
+  setting = name ? name : "";
+  if (!widget_busy) {
+    dialog_module::widget_set_button_name((int)type, (char *)setting.c_str());
+    setting = dialog_module::widget_get_button_name((int)type);
+  }
   return 0;
 }
 
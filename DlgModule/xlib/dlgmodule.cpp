@@ -29,26 +29,35 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <cmath>
 #include <climits>
+#include <cstdint>
+#include <cerrno>
 
 #include <mutex>
 #include <string>
 #include <thread>
 #include <chrono>
+#include <condition_variable>
 #include <vector>
 #include <sstream>
 #include <algorithm>
 #include <unordered_map>
+#include <memory>
 
 #include "../Universal/dlgmodule.h"
 #include "lib/cproc/cproc.hpp"
+#include "lib/xproc/xproc.hpp"
+#include "lib/xdisplay/xdisplay.hpp"
 #include "lodepng.h"
+#include "icon_pack.hpp"
 
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <sys/stat.h>
 
 #include <pthread.h>
+#include <spawn.h>
 #include <libgen.h>
 #include <unistd.h>
 #include <fcntl.h>
@@ -57,6 +66,8 @@
 #include <X11/Xatom.h>
 #include <X11/Xutil.h>
 
+extern char **environ;
+
 using std::string;
 using std::to_string;
 using std::vector;
@@ -99,55 +110,128 @@ int      dialog_ypos   = 0;
 unsigned dialog_width  = 0;
 unsigned dialog_height = 0;
 
-unsigned nlpo2dc(unsigned x) {
-  x--;
-  x |= x >> 1;
-  x |= x >> 2;
-  x |= x >> 4;
-  x |= x >> 8;
-  return x | (x >> 16);
+// RGBA bytes to _NET_WM_ICON pixels: ARGB in the low 32 bits of an unsigned
+// long, which is what Xlib wants for formar it, with colour weighted by alpha
+// so that transparent edges don't bleed dark fringes into the small sizes.
+void icon_downscale(const unsigned char *src, unsigned sw, unsigned sh, unsigned char *dst, unsigned dw, unsigned dh) {
+  double sx = (double)sw / dw, sy = (double)sh / dh;
+  vector<double> sum(4 * dw);
+  for (unsigned y = 0; y < dh; y++) {
+    std::fill(sum.begin(), sum.end(), 0.0);
+    double y0 = y * sy, y1 = y0 + sy;
+    for (unsigned j = (unsigned)y0; j < sh && j < y1; j++) {
+      double wy = std::min(y1, j + 1.0) - std::max(y0, (double)j);
+      for (unsigned x = 0; x < dw; x++) {
+        double x0 = x * sx, x1 = x0 + sx;
+        double *out = &sum[4 * x];
+        for (unsigned i = (unsigned)x0; i < sw && i < x1; i++) {
+          double w = wy * (std::min(x1, i + 1.0) - std::max(x0, (double)i));
+          const unsigned char *p = src + 4 * ((std::size_t)j * sw + i);
+          double a = p[3] * w;
+          out[0] += p[0] * a;
+          out[1] += p[1] * a;
+          out[2] += p[2] * a;
+          out[3] += a;
+        }
+      }
+    }
+    for (unsigned x = 0; x < dw; x++, dst += 4) {
+      const double *in = &sum[4 * x];
+      double alpha = in[3];
+      dst[3] = (unsigned char)std::lround(std::min(255.0, alpha / (sx * sy)));
+      for (int c = 0; c < 3; c++)
+        dst[c] = (alpha > 0) ? (unsigned char)std::lround(std::min(255.0, in[c] / alpha)) : 0;
+    }
+  }
 }
 
-void XSetIcon(Display *display, Window window, const char *icon) {
-  XSynchronize(display, true);
-  Atom property = XInternAtom(display, "_NET_WM_ICON", true);
+unsigned const icon_sizes[] = { 128, 64, 48, 32, 16 };
 
+// decode a png into a _NET_WM_ICON set: the source image followed by every
+// size in icon_sizes smaller than it, each as width, height, then one ARGB
+// pixel per CARDINAL, so the window manager picks a size instead of
+// resampling on every draw. returns false if the file can't be decoded.
+bool icon_decode(const char *icon, vector<unsigned long> &cardinals) {
   unsigned char *data = nullptr;
   unsigned pngwidth, pngheight;
   unsigned error = lodepng_decode32_file(&data, &pngwidth, &pngheight, icon);
-  if (error) return;
-
-  unsigned
-    widfull = nlpo2dc(pngwidth) + 1,
-    hgtfull = nlpo2dc(pngheight) + 1,
-    ih, iw;
-
-  const int bitmap_size = widfull * hgtfull * 4;
-  unsigned char *bitmap = new unsigned char[bitmap_size]();
-
-  unsigned i = 0;
-  unsigned elem_numb = 2 + pngwidth * pngheight;
-  unsigned long *result = new unsigned long[elem_numb]();
-
-  result[i++] = pngwidth;
-  result[i++] = pngheight;
-  for (ih = 0; ih < pngheight; ih++) {
-    unsigned tmp = ih * widfull * 4;
-    for (iw = 0; iw < pngwidth; iw++) {
-      bitmap[tmp + 0] = data[4 * pngwidth * ih + iw * 4 + 2];
-      bitmap[tmp + 1] = data[4 * pngwidth * ih + iw * 4 + 1];
-      bitmap[tmp + 2] = data[4 * pngwidth * ih + iw * 4 + 0];
-      bitmap[tmp + 3] = data[4 * pngwidth * ih + iw * 4 + 3];
-      result[i++] = bitmap[tmp + 0] | (bitmap[tmp + 1] << 8) | (bitmap[tmp + 2] << 16) | (bitmap[tmp + 3] << 24);
-      tmp += 4;
-    }
+  if (error) return false;
+  unsigned longest = std::max(pngwidth, pngheight);
+  std::size_t total = 2 + (std::size_t)pngwidth * pngheight;
+  vector<std::pair<unsigned, unsigned>> scaled;
+  for (unsigned size : icon_sizes) {
+    if (size >= longest) continue;
+    // keep the aspect ratio, fitting the longer side to size.
+    unsigned width = std::max(1u, (unsigned)(((unsigned long long)pngwidth * size + longest / 2) / longest));
+    unsigned height = std::max(1u, (unsigned)(((unsigned long long)pngheight * size + longest / 2) / longest));
+    scaled.emplace_back(width, height);
+    total += 2 + (std::size_t)width * height;
+  }
+  cardinals.resize(total);
+  unsigned long *out = cardinals.data();
+  *out++ = pngwidth;
+  *out++ = pngheight;
+  icon_pack(data, out, (std::size_t)pngwidth * pngheight);
+  out += (std::size_t)pngwidth * pngheight;
+  vector<unsigned char> pixels;
+  for (const auto &size : scaled) {
+    pixels.resize(4 * (std::size_t)size.first * size.second);
+    icon_downscale(data, pngwidth, pngheight, pixels.data(), size.first, size.second);
+    *out++ = size.first;
+    *out++ = size.second;
+    icon_pack(pixels.data(), out, (std::size_t)size.first * size.second);
+    out += (std::size_t)size.first * size.second;
   }
+  free(data);
+  return true;
+}
+
+// decoded icons by path. an entry stays valid while the file keeps its size and
+// mtime, so reapplying an unchanged icon costs one stat instead of a decode.
+struct icon_cache_entry {
+  off_t size;
+  struct timespec mtime;
+  std::shared_ptr<const vector<unsigned long>> cardinals;
+};
 
-  XChangeProperty(display, window, property, XA_CARDINAL, 32, PropModeReplace, (unsigned char *)result, elem_numb);
+std::mutex icon_cache_mutex;
+std::unordered_map<string, icon_cache_entry> icon_cache;
+std::size_t const icon_cache_max = 16;
+
+std::shared_ptr<const vector<unsigned long>> icon_cardinals(const char *icon) {
+  struct stat info;
+  if (stat(icon, &info) == -1) return nullptr;
+  {
+    std::lock_guard<std::mutex> guard(icon_cache_mutex);
+    auto it = icon_cache.find(icon);
+    if (it != icon_cache.end() && it->second.size == info.st_size &&
+      it->second.mtime.tv_sec == info.st_mtim.tv_sec && it->second.mtime.tv_nsec == info.st_mtim.tv_nsec)
+      return it->second.cardinals;
+  }
+  // decode outside the lock; two threads racing on a new icon both decode it.
+  auto cardinals = std::make_shared<vector<unsigned long>>();
+  if (!icon_decode(icon, *cardinals)) return nullptr;
+  std::lock_guard<std::mutex> guard(icon_cache_mutex);
+  if (icon_cache.size() >= icon_cache_max && icon_cache.find(icon) == icon_cache.end())
+    icon_cache.clear();
+  icon_cache[icon] = { info.st_size, info.st_mtim, cardinals };
+  return cardinals;
+}
+
+// the window and icon set last sent by this thread. every dialog polls its
+// own window from its own thread, so an unchanged icon is sent only once.
+thread_local Window icon_window = 0;
+thread_local std::shared_ptr<const vector<unsigned long>> icon_applied;
+
+void XSetIcon(Display *display, Window window, const char *icon) {
+  Atom property = ngs::xdisplay::atom_get_cached(ngs::xdisplay::NET_WM_ICON);
+  std::shared_ptr<const vector<unsigned long>> cardinals = icon_cardinals(icon);
+  if (!cardinals) return;
+  if (window == icon_window && cardinals == icon_applied) return;
+  icon_window = window;
+  icon_applied = cardinals;
+  XChangeProperty(display, window, property, XA_CARDINAL, 32, PropModeReplace, (unsigned char *)cardinals->data(), (int)cardinals->size());
   XFlush(display);
-  delete[] result;
-  delete[] bitmap;
-  delete[] data;
 }
 
 string string_replace_all(string str, string substr, string nstr) {
@@ -197,38 +281,24 @@ string filename_ext(string fname) {
   return fname.substr(fp);
 }
 
-static inline int XErrorHandlerImpl(Display *display, XErrorEvent *event) {
-  return 0;
-}
-
-static inline int XIOErrorHandlerImpl(Display *display) {
-  return 0;
-}
-
-static inline void SetErrorHandlers() {
-  XSetErrorHandler(XErrorHandlerImpl);
-  XSetIOErrorHandler(XIOErrorHandlerImpl);
-}
-
 void change_relative_to_kwin() {
   setenv("WAYLAND_DISPLAY", "", 1);
   if (dm_dialogengine == dm_x11) {
-    Display *display = XOpenDisplay(nullptr);
-    Atom aKWinRunning = XInternAtom(display, "KWIN_RUNNING", true);
+    auto lock = ngs::xdisplay::display_lock();
+    Display *display = ngs::xdisplay::display_get_shared();
+    Atom aKWinRunning = display ? XInternAtom(display, "KWIN_RUNNING", true) : None;
     bool bKWinRunning = (aKWinRunning != None);
     if (bKWinRunning) dm_dialogengine = dm_kdialog;
     else dm_dialogengine = dm_zenity;
-    XCloseDisplay(display);
   }
 }
 
-static int index = -1;
-static std::unordered_map<int, XPROCID> child_proc_id;
-static std::unordered_map<int, bool> proc_did_execute;
-static std::unordered_map<CPROCID, std::intptr_t> stdipt_map;
 static std::unordered_map<CPROCID, std::string> stdopt_map;
 static std::unordered_map<CPROCID, bool> complete_map;
+static std::unordered_map<CPROCID, int> status_map;
 static std::mutex stdopt_mutex;
+static std::mutex complete_mutex;
+static std::condition_variable complete_cond;
 
 static inline const char *executed_process_read_from_standard_output(CPROCID proc_index) {
   if (stdopt_map.find(proc_index) == stdopt_map.end()) return "\0";
@@ -236,156 +306,140 @@ static inline const char *executed_process_read_from_standard_output(CPROCID pro
   return stdopt_map.find(proc_index)->second.c_str();
 }
 
-static inline void free_executed_process_standard_input(CPROCID proc_index) {
-  if (stdipt_map.find(proc_index) == stdipt_map.end()) return;
-  stdipt_map.erase(proc_index);
-}
-
 static inline void free_executed_process_standard_output(CPROCID proc_index) {
   if (stdopt_map.find(proc_index) == stdopt_map.end()) return;
   stdopt_map.erase(proc_index);
 }
 
-static inline bool completion_status_from_executed_process(CPROCID proc_index) {
-  if (complete_map.find(proc_index) == complete_map.end()) return false;
-  return complete_map.find(proc_index)->second;
-}
+// spawn argv[0] from PATH directly; stdin and stderr go to /dev/null.
+// glibc 2.34 and freebsd 13.1 can close inherited descriptors as a spawn file
+// action; elsewhere we fall back to fork and sanitize the table by hand.
+#if (defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 34))) || \
+  (defined(__FreeBSD__) && defined(__FreeBSD_version) && __FreeBSD_version >= 1301000)
+#define SPAWN_HAS_ADDCLOSEFROM
+#endif
 
-static inline XPROCID process_execute_helper(const char *command, int *infp, int *outfp) {
-  int p_stdin[2];
+static inline XPROCID process_spawn(const vector<string> &argv, int *outfp) {
+  if (argv.empty()) return -1;
   int p_stdout[2];
-  XPROCID pid = -1;
-  if (pipe(p_stdin) == -1)
-    return -1;
-  if (pipe(p_stdout) == -1) {
-    close(p_stdin[0]);
-    close(p_stdin[1]);
+  if (!ngs::xproc::pipe_cloexec(p_stdout))
     return -1;
-  }
+  vector<char *> args;
+  for (const string &arg : argv)
+    args.push_back((char *)arg.c_str());
+  args.push_back(nullptr);
+  pid_t pid = -1;
+  #if defined(SPAWN_HAS_ADDCLOSEFROM)
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_addopen(&actions, 0, "/dev/null", O_RDONLY, 0);
+  posix_spawn_file_actions_adddup2(&actions, p_stdout[1], 1);
+  posix_spawn_file_actions_addopen(&actions, 2, "/dev/null", O_WRONLY, 0);
+  posix_spawn_file_actions_addclosefrom_np(&actions, 3);
+  posix_spawnattr_t attr;
+  posix_spawnattr_init(&attr);
+  #if defined(POSIX_SPAWN_SETSID)
+  posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSID);
+  #endif
+  int error = posix_spawnp(&pid, args[0], &actions, &attr, args.data(), environ);
+  posix_spawnattr_destroy(&attr);
+  posix_spawn_file_actions_destroy(&actions);
+  #else
+  int error = 0;
   pid = fork();
-  if (pid < 0) {
-    close(p_stdin[0]);
-    close(p_stdin[1]);
-    close(p_stdout[0]);
-    close(p_stdout[1]);
-    return pid;
-  } else if (pid == 0) {
-    close(p_stdin[1]);
-    dup2(p_stdin[0], 0);
-    close(p_stdout[0]);
+  if (pid == 0) {
+    int devnull = open("/dev/null", O_RDWR);
+    dup2(devnull, 0);
     dup2(p_stdout[1], 1);
-    dup2(open("/dev/null", O_RDONLY), 2);
-    for (int i = 3; i < 4096; i++)
-      close(i);
+    dup2(devnull, 2);
+    ngs::xproc::close_fds_from(3);
     setsid();
-    execl("/bin/sh", "/bin/sh", "-c", command, nullptr);
-    exit(0);
+    execvp(args[0], args.data());
+    _exit(127);
   }
-  close(p_stdin[0]);
+  if (pid < 0) error = errno;
+  #endif
   close(p_stdout[1]);
-  if (infp == nullptr) {
-    close(p_stdin[1]);
-  } else {
-    *infp = p_stdin[1];
-  }
-  if (outfp == nullptr) {
+  if (error) {
     close(p_stdout[0]);
-  } else {
-    *outfp = p_stdout[0];
+    return -1;
   }
-  return pid;
+  *outfp = p_stdout[0];
+  return (XPROCID)pid;
 }
 
 static inline void output_thread(std::intptr_t file, CPROCID proc_index) {
   ssize_t nRead = 0; char buffer[BUFSIZ];
   while ((nRead = read((int)file, buffer, BUFSIZ)) > 0) {
-    buffer[nRead] = '\0';
     std::lock_guard<std::mutex> guard(stdopt_mutex);
     stdopt_map[proc_index].append(buffer, nRead);
   }
 }
 
-static inline XPROCID proc_id_from_fork_proc_id(XPROCID proc_id) {
-  XPROCID *pid = nullptr; int pidsize = 0;
-  std::this_thread::sleep_for(std::chrono::milliseconds(5));
-  ngs::cproc::proc_id_from_parent_proc_id(proc_id, &pid, &pidsize);
-  if (pid) { if (pidsize) { proc_id = pid[pidsize - 1]; }
-  ngs::cproc::free_proc_id(pid); }
-  return proc_id;
-}
-
-static inline CPROCID process_execute(const char *command) {
-  index++;
-  int infd = 0, outfd = 0;
-  XPROCID proc_id = 0, fork_proc_id = 0, wait_proc_id = 0;
-  fork_proc_id = process_execute_helper(command, &infd, &outfd);
-  proc_id = fork_proc_id; wait_proc_id = proc_id;
-  std::this_thread::sleep_for(std::chrono::milliseconds(5));
-  if (fork_proc_id != -1) {
-    while ((proc_id = proc_id_from_fork_proc_id(proc_id)) == wait_proc_id) {
-      std::this_thread::sleep_for(std::chrono::milliseconds(5));
-      int status; wait_proc_id = waitpid(fork_proc_id, &status, WNOHANG);
-      char **cmd = nullptr; int cmdsize; ngs::cproc::cmdline_from_proc_id(fork_proc_id, &cmd, &cmdsize);
-      if (cmd) { if (cmdsize && strcmp(cmd[0], "/bin/sh") == 0) {
-      if (wait_proc_id > 0) proc_id = wait_proc_id; } ngs::cproc::free_cmdline(cmd); }
-    }
-  } else { proc_id = 0; }
-  child_proc_id[index] = proc_id; std::this_thread::sleep_for(std::chrono::milliseconds(5));
-  proc_did_execute[index] = true; CPROCID proc_index = (CPROCID)proc_id;
-  stdipt_map.insert(std::make_pair(proc_index, (std::intptr_t)infd));
-  std::thread opt_thread(output_thread, (std::intptr_t)outfd, proc_index);
-  opt_thread.join();
-  free_executed_process_standard_input(proc_index);
-  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+// drain stdout until eof, reap the child, then wake create_shell_dialog.
+static inline void completion_thread(int outfd, CPROCID proc_index) {
+  output_thread((std::intptr_t)outfd, proc_index);
+  close(outfd);
+  int status = 0; XPROCID wait_proc_id = 0;
+  while ((wait_proc_id = waitpid(proc_index, &status, 0)) == -1 && errno == EINTR);
+  std::lock_guard<std::mutex> guard(complete_mutex);
+  status_map[proc_index] = (wait_proc_id == proc_index && WIFEXITED(status)) ? WEXITSTATUS(status) : -1;
   complete_map[proc_index] = true;
-  return proc_index;
+  complete_cond.notify_all();
 }
 
-static inline CPROCID process_execute_async(const char *command) {
-  int prevIndex = index;
-  std::thread proc_thread(process_execute, command);
-  while (prevIndex == index) {
-    std::this_thread::sleep_for(std::chrono::milliseconds(5));
-  }
-  while (proc_did_execute.find(index) == proc_did_execute.end() || !proc_did_execute[index]) {
-    std::this_thread::sleep_for(std::chrono::milliseconds(5));
-  }
-  CPROCID proc_index = (CPROCID)child_proc_id[index];
-  complete_map[proc_index] = false;
-  proc_thread.detach();
+static inline CPROCID process_execute_async(const vector<string> &argv) {
+  int outfd = -1;
+  XPROCID proc_id = process_spawn(argv, &outfd);
+  if (proc_id == -1) return 0;
+  CPROCID proc_index = (CPROCID)proc_id;
+  { std::lock_guard<std::mutex> guard(complete_mutex);
+  complete_map[proc_index] = false; }
+  std::thread wait_thread(completion_thread, outfd, proc_index);
+  wait_thread.detach();
   return proc_index;
 }
 
 // set dialog transient; set title caption.
 static inline void modify_shell_dialog(XPROCID pid) {
-  SetErrorHandlers(); int sz = 0;
-  WINDOWID *arr = nullptr; Window wid = 0;
-  Display *display = XOpenDisplay(nullptr);
+  int sz = 0; WINDOWID *arr = nullptr; Window wid = 0;
+  auto lock = ngs::xdisplay::display_lock();
+  Display *display = ngs::xdisplay::display_get_shared();
+  if (!display) return;
   ngs::cproc::window_id_from_proc_id(pid, &arr, &sz);
   if (sz) { wid = (Window)ngs::cproc::native_window_from_window_id(arr[sz - 1]);
   XSetIcon(display, wid, widget_get_icon());
   XSetTransientForHint(display, wid, (Window)(std::intptr_t)strtoul(widget_get_owner(), nullptr, 10));
   int len = strlen(widget_get_caption()) + 1; char *buffer = new char[len]();
   strcpy(buffer, widget_get_caption()); XChangeProperty(display, wid,
-  XInternAtom(display, "_NET_WM_NAME", false),
-  XInternAtom(display, "UTF8_STRING", false),
+  ngs::xdisplay::atom_get_cached(ngs::xdisplay::NET_WM_NAME),
+  ngs::xdisplay::atom_get_cached(ngs::xdisplay::UTF8_STRING),
   8, PropModeReplace, (unsigned char *)buffer, len);
   delete[] buffer; Window focus; int revert; while (!modifyInit) { 
-  XSynchronize(display, true); XRaiseWindow(display, wid);
+  XRaiseWindow(display, wid);
   XSetInputFocus(display, wid, RevertToParent, CurrentTime);
-  XFlush(display); XGetInputFocus(display, &focus, &revert);
+  XGetInputFocus(display, &focus, &revert);
   if (wid == focus) modifyInit = true; }
+  XFlush(display);
   ngs::cproc::free_window_id(arr); }
-  XCloseDisplay(display);
 }
 
-string create_shell_dialog(string command) {
+// run zenity/kdialog with argv; exit_code receives the helper's exit status, or -1 if it could not run.
+string create_shell_dialog(vector<string> argv, int *exit_code = nullptr) {
   string output; modifyInit = false;
-  XPROCID pid = process_execute_async(command.c_str());
+  icon_window = 0; icon_applied = nullptr;
+  if (exit_code) *exit_code = -1;
+  XPROCID pid = process_execute_async(argv);
   if (pid) {
-    while (!completion_status_from_executed_process(pid)) {
-      modify_shell_dialog(pid); std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    std::unique_lock<std::mutex> lock(complete_mutex);
+    while (!complete_map[pid]) {
+      lock.unlock(); modify_shell_dialog(pid); lock.lock();
+      complete_cond.wait_for(lock, std::chrono::milliseconds(5), [pid]() { return complete_map[pid]; });
     }
+    if (exit_code) *exit_code = status_map[pid];
+    complete_map.erase(pid);
+    status_map.erase(pid);
+    lock.unlock();
     output = executed_process_read_from_standard_output(pid);
     free_executed_process_standard_output(pid);
     while (!output.empty() && (output.back() == '\r' || output.back() == '\n')) {
@@ -395,10 +449,19 @@ string create_shell_dialog(string command) {
   return output;
 }
 
-string add_escaping(string str, bool is_caption, string new_caption) {
-  string result = str; if (is_caption && str == "") result = new_caption;
-  result = string_replace_all(result, "\"", "\\\"");
-  return result;
+string caption_or_default(string str, string def) {
+  return str.empty() ? def : str;
+}
+
+void append_icon(vector<string> &argv) {
+  if (current_icon == "") current_icon = filename_absolute("assets/icon.png");
+  if (!file_exists(current_icon)) return;
+  if (dm_dialogengine == dm_zenity) {
+    argv.push_back(string("--window-icon=") + current_icon);
+  } else {
+    argv.push_back("--icon");
+    argv.push_back(current_icon);
+  }
 }
 
 string remove_trailing_zeros(double numb) {
@@ -410,7 +473,7 @@ string remove_trailing_zeros(double numb) {
   return strnumb;
 }
 
-string zenity_filter(string input) {
+void zenity_filter(string input, vector<string> &argv) {
   input = string_replace_all(input, "\r", "");
   input = string_replace_all(input, "\n", "");
   std::vector<string> stringVec = string_split(input, '|');
@@ -419,24 +482,21 @@ string zenity_filter(string input) {
   unsigned index = 0;
   for (string str : stringVec) {
     if (index % 2 == 0)
-      string_output += string(" --file-filter=\"") +
-        add_escaping(string_replace_all(str, "*.*", "*"), false, "") + string("|");
+      string_output = string("--file-filter=") + string_replace_all(str, "*.*", "*") + string("|");
     else {
       std::replace(str.begin(), str.end(), ';', ' ');
-      string_output += add_escaping(string_replace_all(str, "*.*", "*"), false, "") + string("\"");
+      argv.push_back(string_output + string_replace_all(str, "*.*", "*"));
     }
 
     index += 1;
   }
-
-  return string_output;
 }
 
 string kdialog_filter(string input) {
   input = string_replace_all(input, "\r", "");
   input = string_replace_all(input, "\n", "");
   std::vector<string> stringVec = string_split(input, '|');
-  string string_output = " \"";
+  string string_output = "";
 
   unsigned index = 0;
   for (string str : stringVec) {
@@ -449,19 +509,24 @@ string kdialog_filter(string input) {
         if (last != string::npos)
           str.erase(first, last - first + 1);
       }
-      string_output += add_escaping(str, false, "") + string(" (");
+      string_output += str + string(" (");
     } else {
       std::replace(str.begin(), str.end(), ';', ' ');
-      string_output += add_escaping(string_replace_all(str, "*.*", "*"), false, "") + string(")");
+      string_output += string_replace_all(str, "*.*", "*") + string(")");
     }
 
     index += 1;
   }
 
-  string_output += "\"";
   return string_output;
 }
 
+string kdialog_start_path(string str_dir, string str_path, string str_fname) {
+  if (!str_dir.empty()) return str_path;
+  char *home = getenv("HOME");
+  return string(home ? home : "") + string("/") + str_fname;
+}
+
 int color_get_red(int col) { return ((col & 0x000000FF)); }
 int color_get_green(int col) { return ((col & 0x0000FF00) >> 8); }
 int color_get_blue(int col) { return ((col & 0x00FF0000) >> 16); }
@@ -472,84 +537,72 @@ int make_color_rgb(unsigned char r, unsigned char g, unsigned char b) {
 
 int show_message_helperfunc(char *str) {
   change_relative_to_kwin();
-  string str_command;
-  string str_title = message_cancel ? add_escaping(caption, true, "Question") : add_escaping(caption, true, "Information");
-  string str_iconflag = (dm_dialogengine == dm_zenity) ? " --window-icon=\"" : " --icon \"";
-  if (current_icon == "") current_icon = filename_absolute("assets/icon.png");
-  string str_icon = file_exists(current_icon) ? str_iconflag + add_escaping(current_icon, false, "") + string("\"") : "";
+  vector<string> argv;
+  string str_title = message_cancel ? caption_or_default(caption, "Question") : caption_or_default(caption, "Information");
   string caption_previous = caption;
   caption = (str_title == "Information") ? "Information" : caption;
   caption = (str_title == "Question") ? "Question" : caption;
 
-  string str_cancel;
-  string str_echo = "echo 1";
-
-  if (message_cancel)
-    str_echo = "if [ $? = 0 ] ;then echo 1;else echo -1;fi";
-
   if (dm_dialogengine == dm_zenity) {
-    string str_icon_2 = string("\" --icon-name=dialog-information") + str_icon + string(");");
-    str_cancel = string("--info --ok-label=\"") + add_escaping(btn_array[BUTTON_OK], true, "") + string("\" ");
-
     if (message_cancel) {
-      str_icon_2 = string("\" --icon-name=dialog-question") + str_icon + string(");");
-      str_cancel = string("--question --ok-label=\"") + add_escaping(btn_array[BUTTON_OK], true, "") + string("\" --cancel-label=\"") + add_escaping(btn_array[BUTTON_CANCEL], true, "") + string("\" ");
+      argv = { "zenity", "--question", string("--ok-label=") + btn_array[BUTTON_OK], string("--cancel-label=") + btn_array[BUTTON_CANCEL],
+        string("--title=") + str_title, "--no-wrap", string("--text=") + str, "--icon-name=dialog-question" };
+    } else {
+      argv = { "zenity", "--info", string("--ok-label=") + btn_array[BUTTON_OK],
+        string("--title=") + str_title, "--no-wrap", string("--text=") + str, "--icon-name=dialog-information" };
     }
-
-    str_command = string("ans=$(zenity ") +
-    str_cancel + string("--title=\"") + str_title + string("\" --no-wrap --text=\"") +
-    add_escaping(str, false, "") + str_icon_2 + str_echo;
+    append_icon(argv);
   }
   else if (dm_dialogengine == dm_kdialog) {
-    str_cancel = string("--msgbox \"") + add_escaping(str, false, "") + string("\" --ok-label \"") + add_escaping(btn_array[BUTTON_OK], true, "") + string("\"") + str_icon + string(" ");
-
-    if (message_cancel)
-      str_cancel = string("--yesno \"") + add_escaping(str, false, "") + string("\" --yes-label \"") + add_escaping(btn_array[BUTTON_OK], true, "") + string("\" --no-label \"") + add_escaping(btn_array[BUTTON_CANCEL], true, "") + string("\"") + str_icon + string(" ");
-
-    str_command = string("kdialog ") +
-    str_cancel + string("--title \"") + str_title + string("\";") + str_echo;
+    if (message_cancel) {
+      argv = { "kdialog", "--yesno", str, "--yes-label", btn_array[BUTTON_OK], "--no-label", btn_array[BUTTON_CANCEL] };
+    } else {
+      argv = { "kdialog", "--msgbox", str, "--ok-label", btn_array[BUTTON_OK] };
+    }
+    append_icon(argv);
+    argv.insert(argv.end(), { "--title", str_title });
   }
 
-  string str_result = create_shell_dialog(str_command);
+  int status = -1;
+  create_shell_dialog(argv, &status);
   caption = caption_previous;
-  double result = strtod(str_result.c_str(), nullptr);
-  return (int)result;
+  if (message_cancel) return (status == 0) ? 1 : -1;
+  return 1;
 }
 
 int show_question_helperfunc(char *str) {
   change_relative_to_kwin();
-  string str_command;
-  string str_title = add_escaping(caption, true, "Question");
-  string str_iconflag = (dm_dialogengine == dm_zenity) ? " --window-icon=\"" : " --icon \"";
-  if (current_icon == "") current_icon = filename_absolute("assets/icon.png");
-  string str_icon = file_exists(current_icon) ? str_iconflag + add_escaping(current_icon, false, "") + string("\"") : "";
+  vector<string> argv;
+  string str_title = caption_or_default(caption, "Question");
   string caption_previous = caption;
   caption = (str_title == "Question") ? "Question" : caption;
-  string str_cancel = "";
+  int status = -1; string str_result;
 
   if (dm_dialogengine == dm_zenity) {
+    argv = { "zenity", "--question", string("--ok-label=") + btn_array[BUTTON_YES], string("--cancel-label=") + btn_array[BUTTON_NO] };
     if (question_cancel)
-      str_cancel = string("--extra-button=\"") + add_escaping(btn_array[BUTTON_CANCEL], true, "") + string("\" ");
+      argv.push_back(string("--extra-button=") + btn_array[BUTTON_CANCEL]);
+    argv.insert(argv.end(), { string("--title=") + str_title, "--no-wrap", string("--text=") + str, "--icon-name=dialog-question" });
+    append_icon(argv);
 
-    str_command = string("ans=$(zenity ") +
-    string("--question --ok-label=\"") + add_escaping(btn_array[BUTTON_YES], true, "") + string("\" --cancel-label=\"") + add_escaping(btn_array[BUTTON_NO], true, "") + string("\" ") + str_cancel +  string("--title=\"") +
-    str_title + string("\" --no-wrap --text=\"") + add_escaping(str, false, "") +
-    string("\" --icon-name=dialog-question") + str_icon + string(");if [ $? = 0 ] ;then echo 1;elif [ $ans = \"") + btn_array[BUTTON_CANCEL] + string("\" ] ;then echo -1;else echo 0;fi");
+    // the extra button exits with status 1 like "No" but prints its own label.
+    str_result = create_shell_dialog(argv, &status);
+    caption = caption_previous;
+    if (status == 0) return 1;
+    if (question_cancel && !str_result.empty() && str_result == btn_array[BUTTON_CANCEL]) return -1;
+    return 0;
   }
   else if (dm_dialogengine == dm_kdialog) {
-    if (question_cancel)
-      str_cancel = "cancel";
-
-    str_command = string("kdialog ") +
-    string("--yesno") + str_cancel + string(" \"") + add_escaping(str, false, "") + string("\" ") +
-    string("--yes-label \"") + add_escaping(btn_array[BUTTON_YES], true, "") + string("\" --no-label \"") + add_escaping(btn_array[BUTTON_NO], true, "") + string("\" ") + string("--title \"") + str_title + string("\" ") + str_icon + string(";") +
-    string("x=$? ;if [ $x = 0 ] ;then echo 1;elif [ $x = 1 ] ;then echo 0;elif [ $x = 2 ] ;then echo -1;fi");
+    argv = { "kdialog", question_cancel ? "--yesnocancel" : "--yesno", str,
+      "--yes-label", btn_array[BUTTON_YES], "--no-label", btn_array[BUTTON_NO], "--title", str_title };
+    append_icon(argv);
   }
 
-  string str_result = create_shell_dialog(str_command);
+  create_shell_dialog(argv, &status);
   caption = caption_previous;
-  double result = strtod(str_result.c_str(), nullptr);
-  return (int)result;
+  if (status == 0) return 1;
+  if (status == 2) return -1;
+  return 0;
 }
 
 } // anonymous namespace
@@ -576,136 +629,110 @@ int show_question_cancelable(char *str) {
 
 int show_attempt(char *str) {
   change_relative_to_kwin();
-  string str_command;
-  string str_title = add_escaping(caption, true, "Error");
-  string str_iconflag = (dm_dialogengine == dm_zenity) ? " --window-icon=\"" : " --icon \"";
-  if (current_icon == "") current_icon = filename_absolute("assets/icon.png");
-  string str_icon = file_exists(current_icon) ? str_iconflag + add_escaping(current_icon, false, "") + string("\"") : "";
+  vector<string> argv;
+  string str_title = caption_or_default(caption, "Error");
   string caption_previous = caption;
   caption = (str_title == "Error") ? "Error" : caption;
 
   if (dm_dialogengine == dm_zenity) {
-    str_command = string("ans=$(zenity ") +
-    string("--question --ok-label=\"") + add_escaping(btn_array[BUTTON_RETRY], true, "") + string("\" --cancel-label=\"") + add_escaping(btn_array[BUTTON_CANCEL], true, "") + string("\" ") +  string("--title=\"") +
-    str_title + string("\" --no-wrap --text=\"") + add_escaping(str, false, "") +
-    string("\" --icon-name=dialog-error ") + str_icon + string(");if [ $? = 0 ] ;then echo 0;else echo -1;fi");
+    argv = { "zenity", "--question", string("--ok-label=") + btn_array[BUTTON_RETRY], string("--cancel-label=") + btn_array[BUTTON_CANCEL],
+      string("--title=") + str_title, "--no-wrap", string("--text=") + str, "--icon-name=dialog-error" };
+    append_icon(argv);
   }
   else if (dm_dialogengine == dm_kdialog) {
-    str_command = string("kdialog ") +
-    string("--warningyesno") + string(" \"") + add_escaping(str, false, "") + string("\" ") +
-    string("--yes-label \"") + add_escaping(btn_array[BUTTON_RETRY], true, "") + string("\" --no-label \"") + add_escaping(btn_array[BUTTON_CANCEL], true, "") + string("\" ") + string("--title \"") +
-    str_title + string("\" ") + str_icon + string(";") + string("x=$? ;if [ $x = 0 ] ;then echo 0;else echo -1;fi");
+    argv = { "kdialog", "--warningyesno", str, "--yes-label", btn_array[BUTTON_RETRY], "--no-label", btn_array[BUTTON_CANCEL],
+      "--title", str_title };
+    append_icon(argv);
   }
 
-  string str_result = create_shell_dialog(str_command);
+  int status = -1;
+  create_shell_dialog(argv, &status);
   caption = caption_previous;
-  double result = strtod(str_result.c_str(), nullptr);
-  return (int)result;
+  return (status == 0) ? 0 : -1;
 }
 
 int show_error(char *str, bool abort) {
   change_relative_to_kwin();
-  string str_command;
-  string str_title = add_escaping(caption, true, "Error");
-  string str_iconflag = (dm_dialogengine == dm_zenity) ? " --window-icon=\"" : " --icon \"";
-  if (current_icon == "") current_icon = filename_absolute("assets/icon.png");
-  string str_icon = file_exists(current_icon) ? str_iconflag + add_escaping(current_icon, false, "") + string("\"") : "";
+  vector<string> argv;
+  string str_title = caption_or_default(caption, "Error");
   string caption_previous = caption;
   caption = (str_title == "Error") ? "Error" : caption;
-  string str_echo;
 
   if (dm_dialogengine == dm_zenity) {
-    str_echo = abort ? "echo 1" : "if [ $? = 0 ] ;then echo 1;else echo -1;fi";
-
     if (abort) {
-      str_command = string("ans=$(zenity ") +
-      string("--info --ok-label=\"") + add_escaping(btn_array[BUTTON_ABORT], true, "") + string("\" ") +
-      string("--title=\"") + str_title + string("\" --no-wrap --text=\"") +
-      add_escaping(str, false, "") + string("\" --icon-name=dialog-error ") + str_icon + string(");") + str_echo;
+      argv = { "zenity", "--info", string("--ok-label=") + btn_array[BUTTON_ABORT],
+        string("--title=") + str_title, "--no-wrap", string("--text=") + str, "--icon-name=dialog-error" };
     } else {
-      str_command = string("ans=$(zenity ") +
-      string("--question --ok-label=\"") + add_escaping(btn_array[BUTTON_ABORT], true, "") + string("\" --cancel-label=\"") + add_escaping(btn_array[BUTTON_IGNORE], true, "") + string("\" ") +
-      string("--title=\"") + str_title + string("\" --no-wrap --text=\"") +
-      add_escaping(str, false, "") + string("\" --icon-name=dialog-error ") + str_icon + string(");") + str_echo;
+      argv = { "zenity", "--question", string("--ok-label=") + btn_array[BUTTON_ABORT], string("--cancel-label=") + btn_array[BUTTON_IGNORE],
+        string("--title=") + str_title, "--no-wrap", string("--text=") + str, "--icon-name=dialog-error" };
     }
+    append_icon(argv);
   }
   else if (dm_dialogengine == dm_kdialog) {
-    str_echo = abort ? "echo 1" : "x=$? ;if [ $x = 0 ] ;then echo 1;elif [ $x = 1 ] ;then echo -1;fi";
-
     if (abort) {
-      str_command = string("kdialog ") +
-      string("--sorry \"") + add_escaping(str, false, "") + string("\" ") +
-      string("--ok-label \"") + add_escaping(btn_array[BUTTON_ABORT], true, "") + string("\" ") +
-      string("--title \"") + str_title + string("\" ") + str_icon + string(";") + str_echo;
+      argv = { "kdialog", "--sorry", str, "--ok-label", btn_array[BUTTON_ABORT], "--title", str_title };
     } else {
-      str_command = string("kdialog ") +
-      string("--warningyesno \"") + add_escaping(str, false, "") + string("\" ") +
-      string("--yes-label \"") + add_escaping(btn_array[BUTTON_ABORT], true, "") + string("\" --no-label \"") + add_escaping(btn_array[BUTTON_IGNORE], true, "") + string("\" ") +
-      string("--title \"") + str_title + string("\" ") + str_icon + string(";") + str_echo;
+      argv = { "kdialog", "--warningyesno", str, "--yes-label", btn_array[BUTTON_ABORT], "--no-label", btn_array[BUTTON_IGNORE],
+        "--title", str_title };
     }
+    append_icon(argv);
   }
 
-  string str_result = create_shell_dialog(str_command);
+  int status = -1;
+  create_shell_dialog(argv, &status);
   caption = caption_previous;
-  double result = strtod(str_result.c_str(), nullptr);
+  int result = 1;
+  if (!abort) {
+    if (status == 0) result = 1;
+    else if (dm_dialogengine == dm_zenity || status == 1) result = -1;
+    else result = 0;
+  }
   if (result == 1) exit(0);
-  return (int)result;
+  return result;
 }
 
 char *get_string(char *str, char *def) {
   change_relative_to_kwin();
-  string str_command;
-  string str_title = add_escaping(caption, true, "Input Query");
+  vector<string> argv;
+  string str_title = caption_or_default(caption, "Input Query");
   string caption_previous = caption;
   caption = (str_title == "Input Query") ? "Input Query" : caption;
-  string str_iconflag = (dm_dialogengine == dm_zenity) ? " --window-icon=\"" : " --icon \"";
-  if (current_icon == "") current_icon = filename_absolute("assets/icon.png");
-  string str_icon = file_exists(current_icon) ? str_iconflag + add_escaping(current_icon, false, "") + string("\"") : "";
 
   if (dm_dialogengine == dm_zenity) {
-    str_command = string("ans=$(zenity ") +
-    string("--entry --title=\"") + str_title + string("\"") + str_icon + string(" --text=\"") +
-    add_escaping(str, false, "") + string("\" --entry-text=\"") +
-    add_escaping(def, false, "") + string("\");echo $ans");
+    argv = { "zenity", "--entry", string("--title=") + str_title };
+    append_icon(argv);
+    argv.insert(argv.end(), { string("--text=") + str, string("--entry-text=") + def });
   }
   else if (dm_dialogengine == dm_kdialog) {
-    str_command = string("ans=$(kdialog ") +
-    string("--inputbox \"") + add_escaping(str, false, "") + string("\" \"") +
-    add_escaping(def, false, "") + string("\" --title \"") +
-    str_title + string("\"") + str_icon + string(");echo $ans");
+    argv = { "kdialog", "--inputbox", str, def, "--title", str_title };
+    append_icon(argv);
   }
 
   static string result;
-  result = create_shell_dialog(str_command);
+  result = create_shell_dialog(argv);
   caption = caption_previous;
   return (char *)result.c_str();
 }
 
 char *get_password(char *str, char *def) {
   change_relative_to_kwin();
-  string str_command;
-  string str_title = add_escaping(caption, true, "Input Query");
-  string str_iconflag = (dm_dialogengine == dm_zenity) ? " --window-icon=\"" : " --icon \"";
-  if (current_icon == "") current_icon = filename_absolute("assets/icon.png");
-  string str_icon = file_exists(current_icon) ? str_iconflag + add_escaping(current_icon, false, "") + string("\"") : "";
+  vector<string> argv;
+  string str_title = caption_or_default(caption, "Input Query");
   string caption_previous = caption;
   caption = (str_title == "Input Query") ? "Input Query" : caption;
 
   if (dm_dialogengine == dm_zenity) {
-    str_command = string("ans=$(zenity ") +
-    string("--entry --title=\"") + str_title + string("\"") + str_icon + string(" --text=\"") +
-    add_escaping(str, false, "") + string("\" --hide-text --entry-text=\"") +
-    add_escaping(def, false, "") + string("\");echo $ans");
+    argv = { "zenity", "--entry", string("--title=") + str_title };
+    append_icon(argv);
+    argv.insert(argv.end(), { string("--text=") + str, "--hide-text", string("--entry-text=") + def });
   }
   else if (dm_dialogengine == dm_kdialog) {
-    str_command = string("ans=$(kdialog ") +
-    string("--password \"") + add_escaping(str, false, "") + string("\" \"") +
-    add_escaping(def, false, "") + string("\" --title \"") +
-    str_title + string("\"") + str_icon + string(");echo $ans");
+    argv = { "kdialog", "--password", str, def, "--title", str_title };
+    append_icon(argv);
   }
 
   static string result;
-  result = create_shell_dialog(str_command);
+  result = create_shell_dialog(argv);
   caption = caption_previous;
   return (char *)result.c_str();
 }
@@ -748,30 +775,26 @@ char *get_open_filename(char *filter, char *fname) {
 
 char *get_open_filename_ext(char *filter, char *fname, char *dir, char *title) {
   change_relative_to_kwin();
-  string str_command; string pwd;
+  vector<string> argv;
   string caption_previous = caption;
   if (dm_dialogengine == dm_zenity) {
-    string str_title = add_escaping(title, true, "Open");
+    string str_title = caption_or_default(title, "Open");
     caption = (str_title == "Open") ? "Open" : title;
     string str_fname = filename_name(filename_absolute(fname));
     string str_dir = filename_absolute(dir);
     string str_path; if (!str_dir.empty()) str_path = str_dir + string("/") + str_fname;
-    str_command = string("ans=$(zenity ") +
-    string("--file-selection --title=\"") + str_title + string("\" --filename=\"") +
-    add_escaping(str_path, false, "") + string("\"") + zenity_filter(filter) + string(");echo $ans");
+    argv = { "zenity", "--file-selection", string("--title=") + str_title, string("--filename=") + str_path };
+    zenity_filter(filter, argv);
   } else if (dm_dialogengine == dm_kdialog) {
-    string str_title = add_escaping(title, true, "Open");
+    string str_title = caption_or_default(title, "Open");
     string str_fname = filename_name(filename_absolute(fname));
     string str_dir = filename_absolute(dir);
     string str_path; if (!str_dir.empty()) str_path = str_dir + string("/") + str_fname;
-    if (str_dir.empty()) pwd = string("\"$HOME/") + add_escaping(str_fname, false, "") + string("\"");
-    else pwd = string("\"") + add_escaping(str_path, false, "") + string("\"");
-    str_command = string("ans=$(kdialog ") +
-    string("--getopenfilename ") + pwd + kdialog_filter(filter) +
-    string(" --title \"") + str_title + string("\"") + string(");echo $ans");
+    argv = { "kdialog", "--getopenfilename", kdialog_start_path(str_dir, str_path, str_fname), kdialog_filter(filter),
+      "--title", str_title };
   }
   static string result;
-  result = create_shell_dialog(str_command);
+  result = create_shell_dialog(argv);
   caption = caption_previous;
   if (file_exists(result))
     return (char *)result.c_str();
@@ -784,30 +807,27 @@ char *get_open_filenames(char *filter, char *fname) {
 
 char *get_open_filenames_ext(char *filter, char *fname, char *dir, char *title) {
   change_relative_to_kwin();
-  string str_command; string pwd;
+  vector<string> argv;
   string caption_previous = caption;
   if (dm_dialogengine == dm_zenity) {
-    string str_title = add_escaping(title, true, "Open");
+    string str_title = caption_or_default(title, "Open");
     caption = (str_title == "Open") ? "Open" : title;
     string str_fname = filename_name(filename_absolute(fname));
     string str_dir = filename_absolute(dir);
     string str_path; if (!str_dir.empty()) str_path = str_dir + string("/") + str_fname;
-    str_command = string("zenity ") +
-    string("--file-selection --multiple --separator='\n' --title=\"") + str_title + string("\" --filename=\"") +
-    add_escaping(str_path, false, "") + string("\"") + zenity_filter(filter);
+    argv = { "zenity", "--file-selection", "--multiple", "--separator=\n", string("--title=") + str_title,
+      string("--filename=") + str_path };
+    zenity_filter(filter, argv);
   } else if (dm_dialogengine == dm_kdialog) {
-    string str_title = add_escaping(title, true, "Open");
+    string str_title = caption_or_default(title, "Open");
     string str_fname = filename_name(filename_absolute(fname));
     string str_dir = filename_absolute(dir);
     string str_path; if (!str_dir.empty()) str_path = str_dir + string("/") + str_fname;
-    if (str_dir.empty()) pwd = string("\"$HOME/") + add_escaping(str_fname, false, "") + string("\"");
-    else pwd = string("\"") + add_escaping(str_path, false, "") + string("\"");
-    str_command = string("kdialog ") +
-    string("--getopenfilename ") + pwd + kdialog_filter(filter) +
-    string(" --multiple --separate-output --title \"") + str_title + string("\"");
+    argv = { "kdialog", "--getopenfilename", kdialog_start_path(str_dir, str_path, str_fname), kdialog_filter(filter),
+      "--multiple", "--separate-output", "--title", str_title };
   }
   static string result;
-  result = create_shell_dialog(str_command);
+  result = create_shell_dialog(argv);
   caption = caption_previous;
   std::vector<string> stringVec = string_split(result, '\n');
   bool success = true;
@@ -826,30 +846,27 @@ char *get_save_filename(char *filter, char *fname) {
 
 char *get_save_filename_ext(char *filter, char *fname, char *dir, char *title) {
   change_relative_to_kwin();
-  string str_command; string pwd;
+  vector<string> argv;
   string caption_previous = caption;
   if (dm_dialogengine == dm_zenity) {
-    string str_title = add_escaping(title, true, "Save As");
+    string str_title = caption_or_default(title, "Save As");
     caption = (str_title == "Save As") ? "Save As" : title;
     string str_fname = filename_name(filename_absolute(fname));
     string str_dir = filename_absolute(dir);
     string str_path; if (!str_dir.empty()) str_path = str_dir + string("/") + str_fname;
-    str_command = string("ans=$(zenity ") +
-    string("--file-selection  --save --confirm-overwrite --title=\"") + str_title + string("\" --filename=\"") +
-    add_escaping(str_path, false, "") + string("\"") + zenity_filter(filter) + string(");echo $ans");
+    argv = { "zenity", "--file-selection", "--save", "--confirm-overwrite", string("--title=") + str_title,
+      string("--filename=") + str_path };
+    zenity_filter(filter, argv);
   } else if (dm_dialogengine == dm_kdialog) {
-    string str_title = add_escaping(title, true, "Save As");
+    string str_title = caption_or_default(title, "Save As");
     string str_fname = filename_name(filename_absolute(fname));
     string str_dir = filename_absolute(dir);
     string str_path; if (!str_dir.empty()) str_path = str_dir + string("/") + str_fname;
-    if (str_dir.empty()) pwd = string("\"$HOME/") + add_escaping(str_fname, false, "") + string("\"");
-    else pwd = string("\"") + add_escaping(str_path, false, "") + string("\"");
-    str_command = string("ans=$(kdialog ") +
-    string("--getsavefilename ") + pwd + kdialog_filter(filter) +
-    string(" --title \"") + str_title + string("\"") + string(");echo $ans");
+    argv = { "kdialog", "--getsavefilename", kdialog_start_path(str_dir, str_path, str_fname), kdialog_filter(filter),
+      "--title", str_title };
   }
   static string result;
-  result = create_shell_dialog(str_command);
+  result = create_shell_dialog(argv);
   caption = caption_previous;
   return (char *)result.c_str();
 }
@@ -860,27 +877,25 @@ char *get_directory(char *dname) {
 
 char *get_directory_alt(char *capt, char *root) {
   change_relative_to_kwin();
-  string str_command; string pwd;
+  vector<string> argv;
   string caption_previous = caption;
   if (dm_dialogengine == dm_zenity) {
-    string str_title = add_escaping(capt, true, "Select Directory");
+    string str_title = caption_or_default(capt, "Select Directory");
     caption = (str_title == "Select Directory") ? "Select Directory" : capt;
     string str_dname = root;
-    string str_end = ");if [ $ans = / ] ;then echo $ans;elif [ $? = 1 ] ;then echo $ans/;else echo $ans;fi";
-    str_command = string("ans=$(zenity ") +
-    string("--file-selection --directory --title=\"") + str_title + string("\" --filename=\"") +
-    add_escaping(str_dname, false, "") + string("\"") + str_end;
+    argv = { "zenity", "--file-selection", "--directory", string("--title=") + str_title, string("--filename=") + str_dname };
   } else if (dm_dialogengine == dm_kdialog) {
-    string str_title = add_escaping(capt, true, "Select Directory");
+    string str_title = caption_or_default(capt, "Select Directory");
     string str_dname = root;
-    if (str_dname.empty() || str_dname[0] != '/') pwd = string("\"$HOME/\"");
-    else pwd = string("\"") + add_escaping(str_dname, false, "") + string("\"");
-    str_command = string("ans=$(kdialog ") +
-    string("--getexistingdirectory ") + pwd + string(" --title \"") + str_title + string("\"");
+    char *home = getenv("HOME");
+    if (str_dname.empty() || str_dname[0] != '/') str_dname = string(home ? home : "") + string("/");
+    argv = { "kdialog", "--getexistingdirectory", str_dname, "--title", str_title };
   }
   static string result;
-  result = create_shell_dialog(str_command);
+  result = create_shell_dialog(argv);
   caption = caption_previous;
+  // directories are returned with a trailing slash; a cancelled dialog returns an empty string.
+  if (!result.empty() && result.back() != '/') result += "/";
   return (char *)result.c_str();
 }
 
@@ -890,15 +905,13 @@ int get_color(int defcol) {
 
 int get_color_ext(int defcol, char *title) {
   change_relative_to_kwin();
-  string str_command;
-  string str_title = add_escaping(title, true, "Color");
+  vector<string> argv;
+  string str_title = caption_or_default(title, "Color");
   string caption_previous = caption;
   caption = (str_title == "Color") ? "Color" : title;
   string str_defcol;
   string str_result;
-  string str_iconflag = (dm_dialogengine == dm_zenity) ? " --window-icon=\"" : " --icon \"";
-  if (current_icon == "") current_icon = filename_absolute("assets/icon.png");
-  string str_icon = file_exists(current_icon) ? str_iconflag + add_escaping(current_icon, false, "") + string("\"") : "";
+  int status = -1;
 
   int red; int green; int blue;
   red = color_get_red(defcol);
@@ -908,13 +921,12 @@ int get_color_ext(int defcol, char *title) {
   if (dm_dialogengine == dm_zenity) {
     str_defcol = string("rgb(") + std::to_string(red) + string(",") +
     std::to_string(green) + string(",") + std::to_string(blue) + string(")");
-    str_command = string("ans=$(zenity ") +
-    string("--color-selection --show-palette --title=\"") + str_title + string("\" --color='") +
-    str_defcol + string("'") + str_icon + string(");if [ $? = 0 ] ;then echo $ans;else echo -1;fi");
+    argv = { "zenity", "--color-selection", "--show-palette", string("--title=") + str_title, string("--color=") + str_defcol };
+    append_icon(argv);
 
-    str_result = create_shell_dialog(str_command);
+    str_result = create_shell_dialog(argv, &status);
     caption = caption_previous;
-    if (str_result == "-1") return strtod(str_result.c_str(), nullptr);
+    if (status != 0) return -1;
     str_result = string_replace_all(str_result, "rgba(", "");
     str_result = string_replace_all(str_result, "rgb(", "");
     str_result = string_replace_all(str_result, ")", "");
@@ -935,13 +947,12 @@ int get_color_ext(int defcol, char *title) {
     str_defcol = string("#") + string(hexcol);
     std::transform(str_defcol.begin(), str_defcol.end(), str_defcol.begin(), ::toupper);
 
-    str_command = string("ans=$(kdialog ") +
-    string("--getcolor --default '") + str_defcol + string("' --title \"") + str_title +
-    string("\"") + str_icon + string(");if [ $? = 0 ] ;then echo $ans;else echo -1;fi");
+    argv = { "kdialog", "--getcolor", "--default", str_defcol, "--title", str_title };
+    append_icon(argv);
 
-    str_result = create_shell_dialog(str_command);
+    str_result = create_shell_dialog(argv, &status);
     caption = caption_previous;
-    if (str_result == "-1") return strtod(str_result.c_str(), nullptr);
+    if (status != 0) return -1;
     str_result = str_result.substr(1, str_result.length() - 1);
 
     unsigned int color;
@@ -0,0 +1,103 @@
+/*
+
+ MIT License
+
+ Copyright © 2021 Samuel Venable
+ Copyright © 2021 Nikita Krapivin
+ Copyright © 2021 Robert B. Colton
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <cstddef>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <immintrin.h>
+#define ICON_PACK_X86
+#endif
+
+// the _NET_WM_ICON pixel kernels, in a header of their own so that
+// test/icon_pack_test.cpp can check the vector versions against the scalar one.
+namespace dialog_module {
+
+// RGBA bytes to _NET_WM_ICON pixels: ARGB in the low 32 bits of an unsigned
+// long, which is what Xlib wants for format 32 even where long is 64 bits.
+inline void icon_pack_scalar(const unsigned char *rgba, unsigned long *out, std::size_t count) {
+  for (std::size_t i = 0; i < count; i++, rgba += 4) {
+    out[i] = (unsigned long)rgba[2] | ((unsigned long)rgba[1] << 8) |
+      ((unsigned long)rgba[0] << 16) | ((unsigned long)rgba[3] << 24);
+  }
+}
+
+#if defined(ICON_PACK_X86)
+// sse2 has no byte shuffle, so R and B trade places with shifts and masks.
+__attribute__((target("sse2")))
+inline void icon_pack_sse2(const unsigned char *rgba, unsigned long *out, std::size_t count) {
+  const __m128i alpha_green = _mm_set1_epi32((int)0xff00ff00);
+  const __m128i low_byte = _mm_set1_epi32(0xff);
+  const __m128i zero = _mm_setzero_si128();
+  std::size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128i pixels = _mm_loadu_si128((const __m128i *)(rgba + i * 4));
+    __m128i argb = _mm_or_si128(_mm_and_si128(pixels, alpha_green),
+      _mm_or_si128(_mm_and_si128(_mm_srli_epi32(pixels, 16), low_byte),
+      _mm_slli_epi32(_mm_and_si128(pixels, low_byte), 16)));
+    if (sizeof(unsigned long) == 8) {
+      _mm_storeu_si128((__m128i *)(out + i), _mm_unpacklo_epi32(argb, zero));
+      _mm_storeu_si128((__m128i *)(out + i + 2), _mm_unpackhi_epi32(argb, zero));
+    } else {
+      _mm_storeu_si128((__m128i *)(out + i), argb);
+    }
+  }
+  icon_pack_scalar(rgba + i * 4, out + i, count - i);
+}
+
+__attribute__((target("avx2")))
+inline void icon_pack_avx2(const unsigned char *rgba, unsigned long *out, std::size_t count) {
+  const __m256i swap_red_blue = _mm256_setr_epi8(
+    2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+    2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+  std::size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256i argb = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i *)(rgba + i * 4)), swap_red_blue);
+    if (sizeof(unsigned long) == 8) {
+      _mm256_storeu_si256((__m256i *)(out + i), _mm256_cvtepu32_epi64(_mm256_castsi256_si128(argb)));
+      _mm256_storeu_si256((__m256i *)(out + i + 4), _mm256_cvtepu32_epi64(_mm256_extracti128_si256(argb, 1)));
+    } else {
+      _mm256_storeu_si256((__m256i *)(out + i), argb);
+    }
+  }
+  icon_pack_scalar(rgba + i * 4, out + i, count - i);
+}
+#endif
+
+inline void icon_pack(const unsigned char *rgba, unsigned long *out, std::size_t count) {
+  #if defined(ICON_PACK_X86)
+  static const bool has_avx2 = __builtin_cpu_supports("avx2");
+  static const bool has_sse2 = __builtin_cpu_supports("sse2");
+  if (has_avx2) return icon_pack_avx2(rgba, out, count);
+  if (has_sse2) return icon_pack_sse2(rgba, out, count);
+  #endif
+  icon_pack_scalar(rgba, out, count);
+}
+
+} // namespace dialog_module
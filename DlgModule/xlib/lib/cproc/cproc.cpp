@@ -25,12 +25,20 @@
 */
 
 #include <unordered_map>
+#include <unordered_set>
 #include <algorithm>
+#include <iterator>
+#include <memory>
+#include <atomic>
+#include <future>
 #include <iostream>
 #include <sstream>
 #include <thread>
+#include <chrono>
 #include <string>
+#include <string_view>
 #include <vector>
+#include <deque>
 #include <mutex>
 
 #include <cstdlib>
@@ -39,6 +47,7 @@
 #include <cstring>
 #include <climits>
 #include <cstdio>
+#include <cerrno>
 
 #include "lib/cproc/cproc.hpp"
 #include "lib/xproc/xproc.hpp"
@@ -50,6 +59,8 @@
 #include <AppKit/AppKit.h>
 #elif (defined(__linux__) && !defined(__ANDROID__)) || (defined(__FreeBSD__) || defined(__DragonFly__) || defined(__NetBSD__) || defined(__OpenBSD__)) || defined(__sun) || defined(PROCESS_XQUARTZ_IMPL)
 #include <X11/Xlib.h>
+#include <X11/Xatom.h>
+#include "lib/xdisplay/xdisplay.hpp"
 #endif
 #endif
 
@@ -60,37 +71,66 @@
 #include <sys/wait.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <poll.h>
+#if defined(__linux__)
+#include <sys/syscall.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/connector.h>
+#include <linux/cn_proc.h>
+#endif
 #else
 #include <windows.h>
 #endif
 
 namespace {
 
-  #if !defined(_MSC_VER)
-  #pragma pack(push, 8)
-  #else
-  #include <pshpack8.h>
-  #endif
-  typedef struct {
-    char *executable_image_file_path;
-    char *current_working_directory;
-    XPROCID parent_process_id;
-    XPROCID *child_process_id;
-    int child_process_id_length;
-    char **commandline;
-    int commandline_length;
-    char **environment;
-    int environment_length;
+  // storage behind a PROCINFO handle. a field is read from the system the first
+  // time it is asked for, and only if the handle was created with its KINFO flag;
+  // everything the getters hand out points into memory the slot owns. mutex is
+  // held while a field loads and while the slot is set up or cleared, so other
+  // getters never see a field before it is complete.
+  struct proc_info_slot {
+    std::mutex mutex;
+    XPROCID proc_id = 0;
+    KINFOFLAGS requested = 0;
+    KINFOFLAGS loaded = 0;
+    bool in_use = false;
+    std::string executable_image_file_path;
+    std::string current_working_directory;
+    XPROCID parent_process_id = 0;
+    std::vector<XPROCID> child_process_id;
+    std::vector<char> commandline_buffer;
+    std::vector<char *> commandline;
+    std::vector<char> environment_buffer;
+    std::vector<char *> environment;
     #if defined(PROCESS_GUIWINDOW_IMPL)
-    WINDOWID *owned_window_id;
-    int owned_window_id_length;
+    std::vector<std::string> owned_window_id_buffer;
+    std::vector<WINDOWID> owned_window_id;
     #endif
-  } PROCINFO_STRUCT;
-  #if !defined(_MSC_VER)
-  #pragma pack(pop)
-  #else
-  #include <poppack.h>
-  #endif
+  };
+
+  // pids behind a PROCLIST, sorted ascending.
+  struct proc_list_slot {
+    bool in_use = false;
+    std::vector<XPROCID> process_id;
+  };
+
+  // columns of a PROCTABLE; a column the table was not created for stays empty.
+  struct proc_table_slot {
+    bool in_use = false;
+    std::vector<XPROCID> process_id;
+    std::vector<XPROCID> parent_process_id;
+    std::vector<std::string> executable_image_file_path_buffer;
+    std::vector<char *> executable_image_file_path;
+    std::vector<std::string> current_working_directory_buffer;
+    std::vector<char *> current_working_directory;
+    std::vector<int> commandline_length;
+    std::vector<int> environment_length;
+    #if defined(PROCESS_GUIWINDOW_IMPL)
+    std::vector<int> owned_window_id_length;
+    #endif
+  };
 
   void message_pump() {
     #if defined(_WIN32) 
@@ -127,6 +167,201 @@ namespace {
   }
   #endif
 
+  // append-only buffer for a child's standard output. the output thread is the
+  // only writer: it fills fixed-size chunks and publishes the byte count with a
+  // release store, so readers copy anything below that count without taking any
+  // lock the writer uses. chunks are never moved or freed before the stream is.
+  class output_stream {
+    struct chunk {
+      char data[16384];
+      std::atomic<chunk *> next { nullptr };
+    };
+
+  public:
+    struct position {
+      chunk *current = nullptr;
+      std::size_t used = 0;
+      std::size_t offset = 0;
+    };
+
+    output_stream() : head(new chunk), tail(head) {
+      cursor.current = head;
+      snapshot_cursor.current = head;
+    }
+
+    ~output_stream() {
+      while (head) {
+        chunk *next = head->next.load(std::memory_order_relaxed);
+        delete head;
+        head = next;
+      }
+    }
+
+    output_stream(const output_stream &) = delete;
+    output_stream &operator=(const output_stream &) = delete;
+
+    void append(const char *data, std::size_t size) {
+      std::size_t length = published.load(std::memory_order_relaxed);
+      while (size) {
+        if (tail_used == sizeof(tail->data)) {
+          chunk *next = new chunk;
+          tail->next.store(next, std::memory_order_release);
+          tail = next;
+          tail_used = 0;
+        }
+        std::size_t count = std::min(size, sizeof(tail->data) - tail_used);
+        memcpy(tail->data + tail_used, data, count);
+        tail_used += count; data += count; size -= count; length += count;
+        published.store(length, std::memory_order_release);
+      }
+    }
+
+    std::size_t length() const {
+      return published.load(std::memory_order_acquire);
+    }
+
+    // copy up to size bytes past pos and advance it; returns the number copied.
+    std::size_t read(position &pos, char *buffer, std::size_t size) const {
+      std::size_t available = length() - pos.offset;
+      if (size > available) size = available;
+      std::size_t copied = 0;
+      while (copied < size) {
+        if (pos.used == sizeof(pos.current->data)) {
+          pos.current = pos.current->next.load(std::memory_order_acquire);
+          pos.used = 0;
+        }
+        std::size_t count = std::min(size - copied, sizeof(pos.current->data) - pos.used);
+        memcpy(buffer + copied, pos.current->data + pos.used, count);
+        pos.used += count; pos.offset += count; copied += count;
+      }
+      return copied;
+    }
+
+    // bytes not yet handed out through the incremental reader.
+    std::size_t read_incremental(char *buffer, std::size_t size) {
+      std::lock_guard<std::mutex> guard(cursor_mutex);
+      return read(cursor, buffer, size);
+    }
+
+    // everything written so far as one string; only new bytes are copied.
+    const char *snapshot() {
+      std::lock_guard<std::mutex> guard(snapshot_mutex);
+      std::size_t size = length() - snapshot_cursor.offset;
+      if (size) {
+        std::size_t offset = snapshot_string.length();
+        snapshot_string.resize(offset + size);
+        read(snapshot_cursor, &snapshot_string[offset], size);
+      }
+      return snapshot_string.c_str();
+    }
+
+  private:
+    chunk *head;
+    chunk *tail;
+    std::size_t tail_used = 0;
+    std::atomic<std::size_t> published { 0 };
+    std::mutex cursor_mutex;
+    position cursor;
+    std::mutex snapshot_mutex;
+    position snapshot_cursor;
+    std::string snapshot_string;
+  };
+
+  // everything cproc tracks for one executed process. the launching thread, the
+  // output thread and api callers each hold a reference, so an entry outlives its
+  // removal from the registry for as long as anyone is still using it.
+  struct executed_process {
+    std::atomic<bool> complete { false };
+    std::atomic<bool> input_freed { false };
+    std::atomic<bool> output_freed { false };
+    std::mutex input_mutex;
+    std::intptr_t standard_input = -1;
+    output_stream standard_output;
+
+    void close_standard_input() {
+      std::lock_guard<std::mutex> guard(input_mutex);
+      if (standard_input == -1) return;
+      #if !defined(_WIN32)
+      close((int)standard_input);
+      #else
+      CloseHandle((HANDLE)(void *)standard_input);
+      #endif
+      standard_input = -1;
+    }
+  };
+
+  // executed processes keyed by handle. lookups only lock the shard the handle
+  // hashes to, so concurrent launches and reads rarely contend.
+  class executed_process_registry {
+  public:
+    std::shared_ptr<executed_process> insert(CPROCID proc_index) {
+      std::shared_ptr<executed_process> entry = std::make_shared<executed_process>();
+      shard &s = shard_for(proc_index);
+      std::lock_guard<std::mutex> guard(s.mutex);
+      s.entries[proc_index] = entry;
+      s.released.erase(proc_index);
+      return entry;
+    }
+
+    std::shared_ptr<executed_process> find(CPROCID proc_index) {
+      shard &s = shard_for(proc_index);
+      std::lock_guard<std::mutex> guard(s.mutex);
+      auto it = s.entries.find(proc_index);
+      if (it == s.entries.end()) return nullptr;
+      return it->second;
+    }
+
+    // drop the entry once it has completed and both of its streams were freed.
+    // the handle is remembered as completed, so completion polling keeps
+    // returning true after the streams are gone, as it always has. only the
+    // last released_limit handles per shard are remembered; each tombstone
+    // carries a sequence number so evicting a slot left behind by a reused
+    // pid cannot drop that pid's newer tombstone.
+    void release(CPROCID proc_index, const std::shared_ptr<executed_process> &entry) {
+      if (!entry->complete || !entry->input_freed || !entry->output_freed) return;
+      shard &s = shard_for(proc_index);
+      std::lock_guard<std::mutex> guard(s.mutex);
+      auto it = s.entries.find(proc_index);
+      if (it == s.entries.end() || it->second != entry) return;
+      s.entries.erase(it);
+      std::uint64_t sequence = s.released_sequence++;
+      s.released[proc_index] = sequence;
+      s.released_order.emplace_back(proc_index, sequence);
+      if (s.released_order.size() > released_limit) {
+        auto oldest = s.released.find(s.released_order.front().first);
+        if (oldest != s.released.end() && oldest->second == s.released_order.front().second)
+          s.released.erase(oldest);
+        s.released_order.pop_front();
+      }
+    }
+
+    bool completed(CPROCID proc_index) {
+      shard &s = shard_for(proc_index);
+      std::lock_guard<std::mutex> guard(s.mutex);
+      auto it = s.entries.find(proc_index);
+      if (it != s.entries.end()) return it->second->complete;
+      return (s.released.find(proc_index) != s.released.end());
+    }
+
+  private:
+    struct shard {
+      std::mutex mutex;
+      std::unordered_map<CPROCID, std::shared_ptr<executed_process>> entries;
+      std::unordered_map<CPROCID, std::uint64_t> released;
+      std::deque<std::pair<CPROCID, std::uint64_t>> released_order;
+      std::uint64_t released_sequence = 0;
+    };
+    static constexpr std::size_t shard_count = 16;
+    static constexpr std::size_t released_limit = 256;
+    shard shards[shard_count];
+
+    shard &shard_for(CPROCID proc_index) {
+      return shards[std::hash<CPROCID>()(proc_index) % shard_count];
+    }
+  };
+
+  executed_process_registry executed_processes;
+
 } // anonymous namespace
 
 namespace ngs::cproc {
@@ -259,11 +494,6 @@ namespace ngs::cproc {
     #endif
   }
 
-  static std::unordered_map<CPROCID, std::intptr_t> stdipt_map;
-  static std::unordered_map<CPROCID, std::string> stdopt_map;
-  static std::unordered_map<CPROCID, bool> complete_map;
-  static std::mutex stdopt_mutex;
-
   void cwd_from_proc_id(XPROCID proc_id, char **buffer) {
     *buffer = nullptr;
     static std::string str;
@@ -284,16 +514,15 @@ namespace ngs::cproc {
 
   void cmdline_from_proc_id(XPROCID proc_id, char ***buffer, int *size) {
     *buffer = nullptr; *size = 0;
-    static std::vector<std::string> cmdline_vec_1;
-    cmdline_vec_1 = ngs::xproc::cmdline_from_proc_id(proc_id);
-    std::vector<char *> cmdline_vec_2;
-    for (std::size_t i = 0; i < cmdline_vec_1.size(); i++) {
+    static std::vector<char> cmdline_buffer;
+    static std::vector<std::string_view> cmdline_vec;
+    ngs::xproc::cmdline_from_proc_id(proc_id, cmdline_buffer, cmdline_vec);
+    char **arr = new char *[cmdline_vec.size()]();
+    for (std::size_t i = 0; i < cmdline_vec.size(); i++) {
       message_pump();
-      cmdline_vec_2.push_back((char *)cmdline_vec_1[i].c_str());
+      arr[i] = (char *)cmdline_vec[i].data();
     }
-    char **arr = new char *[cmdline_vec_2.size()]();
-    std::copy(cmdline_vec_2.begin(), cmdline_vec_2.end(), arr);
-    *buffer = arr; *size = (int)cmdline_vec_2.size();
+    *buffer = arr; *size = (int)cmdline_vec.size();
   }
 
   void free_environ(char **buffer) {
@@ -304,16 +533,15 @@ namespace ngs::cproc {
 
   void environ_from_proc_id(XPROCID proc_id, char ***buffer, int *size) {
     *buffer = nullptr; *size = 0;
-    static std::vector<std::string> environ_vec_1;
-    environ_vec_1 = ngs::xproc::environ_from_proc_id(proc_id);
-    std::vector<char *> environ_vec_2;
-    for (std::size_t i = 0; i < environ_vec_1.size(); i++) {
+    static std::vector<char> environ_buffer;
+    static std::vector<std::string_view> environ_vec;
+    ngs::xproc::environ_from_proc_id(proc_id, environ_buffer, environ_vec);
+    char **arr = new char *[environ_vec.size()]();
+    for (std::size_t i = 0; i < environ_vec.size(); i++) {
       message_pump();
-      environ_vec_2.push_back((char *)environ_vec_1[i].c_str());
+      arr[i] = (char *)environ_vec[i].data();
     }
-    char **arr = new char *[environ_vec_2.size()]();
-    std::copy(environ_vec_2.begin(), environ_vec_2.end(), arr);
-    *buffer = arr; *size = (int)environ_vec_2.size();
+    *buffer = arr; *size = (int)environ_vec.size();
   }
 
   void environ_from_proc_id_ex(XPROCID proc_id, const char *name, char **value) {
@@ -420,21 +648,6 @@ namespace ngs::cproc {
   }
 
   #if defined(PROCESS_GUIWINDOW_IMPL)
-  #if (defined(__linux__) && !defined(__ANDROID__)) || (defined(__FreeBSD__) || defined(__DragonFly__) || defined(__NetBSD__) || defined(__OpenBSD__)) || defined(__sun) || (defined(__APPLE__) && defined(__MACH__) && defined(PROCESS_XQUARTZ_IMPL))
-  static inline int x_error_handler_impl(Display *display, XErrorEvent *event) {
-    return 0;
-  }
-
-  static inline int x_io_error_handler_impl(Display *display) {
-    return 0;
-  }
-
-  static inline void set_error_handlers() {
-    XSetErrorHandler(x_error_handler_impl);
-    XSetIOErrorHandler(x_io_error_handler_impl);
-  }
-  #endif
-
   WINDOWID window_id_from_native_window(WINDOW window) {
     static std::string res;
     #if (defined(__APPLE__) && defined(__MACH__)) && !defined(PROCESS_XQUARTZ_IMPL)
@@ -453,23 +666,17 @@ namespace ngs::cproc {
     #endif
   }
 
-  void window_id_from_proc_id(XPROCID proc_id, WINDOWID **win_id, int *size) {
-    static std::vector<std::string> wid_vec_1;
-    *win_id = nullptr; *size = 0;
-    wid_vec_1.clear();
-    if (!proc_id_exists(proc_id)) return;
+  // every top-level window with the process owning it, topmost first, read in a
+  // single pass. owners that no longer exist are reported as 0, the same as
+  // proc_id_from_window_id does. on x11 that is one client list read and one
+  // _NET_WM_PID request per window instead of a full pass per process.
+  static std::vector<std::pair<std::string, XPROCID>> window_proc_id_table() {
+    std::vector<std::pair<std::string, XPROCID>> table;
     #if defined(_WIN32)
-    HWND hWnd = GetTopWindow(GetDesktopWindow());
-    XPROCID pid = 0; proc_id_from_window_id(window_id_from_native_window((WINDOW)hWnd), &pid);
-    if (proc_id == pid) {
-      wid_vec_1.push_back(window_id_from_native_window((WINDOW)hWnd));
-    }
-    while (hWnd = GetWindow(hWnd, GW_HWNDNEXT)) {
+    for (HWND hWnd = GetTopWindow(GetDesktopWindow()); hWnd; hWnd = GetWindow(hWnd, GW_HWNDNEXT)) {
       message_pump();
-      XPROCID pid = 0; proc_id_from_window_id(window_id_from_native_window((WINDOW)hWnd), &pid);
-      if (proc_id == pid) {
-        wid_vec_1.push_back(window_id_from_native_window((WINDOW)hWnd));
-      }
+      DWORD pid = 0; GetWindowThreadProcessId(hWnd, &pid);
+      table.emplace_back(window_id_from_native_window((WINDOW)hWnd), (XPROCID)pid);
     }
     #elif (defined(__APPLE__) && defined(__MACH__)) && !defined(PROCESS_XQUARTZ_IMPL)
     CFArrayRef window_array = CGWindowListCopyWindowInfo(
@@ -482,40 +689,62 @@ namespace ngs::cproc {
         CFNumberRef ownerPID = (CFNumberRef)CFDictionaryGetValue(
         windowInfoDictionary, kCGWindowOwnerPID); XPROCID pid = 0;
         CFNumberGetValue(ownerPID, kCFNumberIntType, &pid);
-        if (proc_id == pid) {
-          CFNumberRef windowID = (CFNumberRef)CFDictionaryGetValue(
-          windowInfoDictionary, kCGWindowNumber);
-          CGWindowID wid; CFNumberGetValue(windowID, kCGWindowIDCFNumberType, &wid);
-          wid_vec_1.push_back(std::to_string((unsigned long)wid));
-        }
+        CFNumberRef windowID = (CFNumberRef)CFDictionaryGetValue(
+        windowInfoDictionary, kCGWindowNumber);
+        CGWindowID wid; CFNumberGetValue(windowID, kCGWindowIDCFNumberType, &wid);
+        table.emplace_back(std::to_string((unsigned long)wid), pid);
       }
     }
     CFRelease(window_array);
     #elif (defined(__linux__) && !defined(__ANDROID__)) || (defined(__FreeBSD__) || defined(__DragonFly__) || defined(__NetBSD__) || defined(__OpenBSD__)) || defined(__sun) || defined(PROCESS_XQUARTZ_IMPL)
-    set_error_handlers();
-    Display *display = XOpenDisplay(nullptr);
+    auto lock = ngs::xdisplay::display_lock();
+    Display *display = ngs::xdisplay::display_get_shared();
+    if (!display) return table;
     Window window = XDefaultRootWindow(display);
+    Atom client_list = ngs::xdisplay::atom_get_cached(ngs::xdisplay::NET_CLIENT_LIST_STACKING);
+    Atom wm_pid = ngs::xdisplay::atom_get_cached(ngs::xdisplay::NET_WM_PID);
+    std::vector<Window> windows;
     unsigned char *prop = nullptr;
-    Atom actual_type = 0, filter_atom = 0;
-    int actual_format = 0, status = 0;
+    Atom actual_type = 0;
+    int actual_format = 0;
     unsigned long nitems = 0, bytes_after = 0;
-    filter_atom = XInternAtom(display, "_NET_CLIENT_LIST_STACKING", true);
-    status = XGetWindowProperty(display, window, filter_atom, 0, 1024, false,
-    AnyPropertyType, &actual_type, &actual_format, &nitems, &bytes_after, &prop);
-    if (status == Success && prop != nullptr && nitems) {
+    if (XGetWindowProperty(display, window, client_list, 0, LONG_MAX / 4, false, AnyPropertyType,
+      &actual_type, &actual_format, &nitems, &bytes_after, &prop) == Success && prop != nullptr) {
       if (actual_format == 32) {
         unsigned long *array = (unsigned long *)prop;
-        for (int i = nitems - 1; i >= 0; i--) {
-          XPROCID pid; proc_id_from_window_id(window_id_from_native_window((WINDOW)array[i]), &pid);
-          if (proc_id == pid) {
-            wid_vec_1.push_back(window_id_from_native_window((WINDOW)array[i]));
-          }
-        }
+        windows.assign(array, array + nitems);
       }
       XFree(prop);
     }
-    XCloseDisplay(display);
+    for (std::size_t i = windows.size(); i-- > 0;) {
+      XPROCID pid = 0; prop = nullptr;
+      if (XGetWindowProperty(display, windows[i], wm_pid, 0, 1, false, XA_CARDINAL,
+        &actual_type, &actual_format, &nitems, &bytes_after, &prop) == Success && prop != nullptr) {
+        if (actual_format == 32 && nitems) pid = (XPROCID)*(unsigned long *)prop;
+        XFree(prop);
+      }
+      table.emplace_back(std::to_string((unsigned long long)windows[i]), pid);
+    }
+    lock.unlock();
     #endif
+    for (std::size_t i = 0; i < table.size(); i++) {
+      if (!proc_id_exists(table[i].second))
+        table[i].second = 0;
+    }
+    return table;
+  }
+
+  void window_id_from_proc_id(XPROCID proc_id, WINDOWID **win_id, int *size) {
+    static std::vector<std::string> wid_vec_1;
+    *win_id = nullptr; *size = 0;
+    wid_vec_1.clear();
+    if (!proc_id_exists(proc_id)) return;
+    std::vector<std::pair<std::string, XPROCID>> table = window_proc_id_table();
+    for (std::size_t i = 0; i < table.size(); i++) {
+      if (table[i].second == proc_id) {
+        wid_vec_1.push_back(std::move(table[i].first));
+      }
+    }
     std::vector<WINDOWID> wid_vec_2;
     for (std::size_t i = 0; i < wid_vec_1.size(); i++) {
       message_pump();
@@ -535,21 +764,10 @@ namespace ngs::cproc {
   void window_id_enumerate(WINDOWID **win_id, int *size) {
     static std::vector<std::string> wid_vec_3;
     *win_id = nullptr; *size = 0;
-    wid_vec_3.clear(); int i = 0;
-    XPROCID *pid = nullptr; int pidsize = 0;
-    proc_id_enumerate(&pid, &pidsize);
-    if (pid) {
-      for (int i = 0; i < pidsize; i++) {
-        message_pump();
-        WINDOWID *wid = nullptr; int widsize = 0;
-        window_id_from_proc_id(pid[i], &wid, &widsize);
-        if (wid) {
-          for (int ii = 0; ii < widsize; ii++) {
-            wid_vec_3.push_back(wid[ii]);
-          }
-          free_window_id(wid);
-        }
-      }
+    wid_vec_3.clear();
+    std::vector<std::pair<std::string, XPROCID>> table = window_proc_id_table();
+    for (std::size_t i = 0; i < table.size(); i++) {
+      wid_vec_3.push_back(std::move(table[i].first));
     }
     std::vector<WINDOWID> widVec4;
     for (int i = 0; i < (int)wid_vec_3.size(); i++) {
@@ -558,7 +776,7 @@ namespace ngs::cproc {
     }
     WINDOWID *arr = new WINDOWID[widVec4.size()]();
     std::copy(widVec4.begin(), widVec4.end(), arr);
-    *win_id = arr; *size = i;
+    *win_id = arr; *size = (int)widVec4.size();
   }
 
   void proc_id_from_window_id(WINDOWID win_id, XPROCID *proc_id) {
@@ -567,39 +785,24 @@ namespace ngs::cproc {
     DWORD pid = 0; GetWindowThreadProcessId((HWND)native_window_from_window_id(win_id), &pid);
     *proc_id = (XPROCID)pid;
     #elif (defined(__APPLE__) && defined(__MACH__)) && !defined(PROCESS_XQUARTZ_IMPL)
-    CFArrayRef window_array = CGWindowListCopyWindowInfo(
-    kCGWindowListOptionIncludingWindow, (CGWindowID)strtol(win_id, nullptr, 10));
-    CFIndex windowCount = 0;
-    if ((windowCount = CFArrayGetCount(window_array))) {
-      for (CFIndex i = 0; i < windowCount; i++) {
-        CFDictionaryRef windowInfoDictionary =
-        (CFDictionaryRef)CFArrayGetValueAtIndex(window_array, i);
-        CFNumberRef ownerPID = (CFNumberRef)CFDictionaryGetValue(
-        windowInfoDictionary, kCGWindowOwnerPID); XPROCID pid = 0;
-        CFNumberGetValue(ownerPID, kCFNumberIntType, &pid);
-        WINDOWID *wid = nullptr; int size = 0;
-        window_id_from_proc_id(pid, &wid, &size);
-        if (wid) {
-          for (int i = 0; i < size; i++) {
-            if (strtoul(win_id, nullptr, 10) == strtoul(wid[i], nullptr, 10)) {
-              *proc_id = pid;
-              break;
-            }
-          }
-          free_window_id(wid);
-        }
+    std::vector<std::pair<std::string, XPROCID>> table = window_proc_id_table();
+    unsigned long wid = strtoul(win_id, nullptr, 10);
+    for (std::size_t i = 0; i < table.size(); i++) {
+      if (strtoul(table[i].first.c_str(), nullptr, 10) == wid) {
+        *proc_id = table[i].second;
+        break;
       }
     }
-    CFRelease(window_array);
     #elif (defined(__linux__) && !defined(__ANDROID__)) || (defined(__FreeBSD__) || defined(__DragonFly__) || defined(__NetBSD__) || defined(__OpenBSD__)) || defined(__sun) || defined(PROCESS_XQUARTZ_IMPL)
-    set_error_handlers();
-    Display *display = XOpenDisplay(nullptr);
+    auto lock = ngs::xdisplay::display_lock();
+    Display *display = ngs::xdisplay::display_get_shared();
+    if (!display) return;
     unsigned long property = 0;
     unsigned char *prop = nullptr;
     Atom actual_type = 0, filter_atom = 0;
     int actual_format = 0, status = 0;
     unsigned long nitems = 0, bytes_after = 0;
-    filter_atom = XInternAtom(display, "_NET_WM_PID", true);
+    filter_atom = ngs::xdisplay::atom_get_cached(ngs::xdisplay::NET_WM_PID);
     status = XGetWindowProperty(display, (Window)native_window_from_window_id(win_id), filter_atom, 0, 1000, false,
     AnyPropertyType, &actual_type, &actual_format, &nitems, &bytes_after, &prop);
     if (status == Success && prop != nullptr) {
@@ -607,7 +810,7 @@ namespace ngs::cproc {
       XFree(prop);
     }
     *proc_id = (XPROCID)property;
-    XCloseDisplay(display);
+    lock.unlock();
     #endif
     if (!proc_id_exists(*proc_id)) {
       *proc_id = 0;
@@ -651,10 +854,73 @@ namespace ngs::cproc {
   }
   #endif
 
-  static int procInfoIndex = -1;
-  static int procListIndex = -1;
-  static std::unordered_map<PROCINFO, PROCINFO_STRUCT *> proc_info_map;
-  static std::vector<std::vector<XPROCID>> proc_list_vec;
+  // PROCINFO handles index into proc_info_slots; freed handles go on a freelist
+  // and are handed out again, so the table only grows to the peak in use.
+  static std::mutex proc_info_mutex;
+  static std::vector<std::unique_ptr<proc_info_slot>> proc_info_slots;
+  static std::vector<PROCINFO> proc_info_free;
+
+  // slots are never destroyed, so the pointer stays valid after the lock is
+  // dropped; whether it is in use is checked under the slot's own mutex.
+  static inline proc_info_slot *proc_info_get(PROCINFO proc_info) {
+    std::lock_guard<std::mutex> guard(proc_info_mutex);
+    if (proc_info < 0 || (std::size_t)proc_info >= proc_info_slots.size()) return nullptr;
+    return proc_info_slots[proc_info].get();
+  }
+
+  static inline void proc_info_pointers(std::vector<char> &buffer, std::vector<char *> &pointers,
+    void (*reader)(ngs::xproc::PROCID, std::vector<char> &, std::vector<std::string_view> &), XPROCID proc_id) {
+    std::vector<std::string_view> views;
+    reader(proc_id, buffer, views);
+    pointers.clear();
+    for (std::string_view view : views)
+      pointers.push_back((char *)view.data());
+  }
+
+  // the slot for proc_info with field loaded, or nullptr if the handle is not
+  // live or was created without that field.
+  static inline proc_info_slot *proc_info_load(PROCINFO proc_info, KINFOFLAGS field) {
+    proc_info_slot *slot = proc_info_get(proc_info);
+    if (!slot) return nullptr;
+    std::lock_guard<std::mutex> guard(slot->mutex);
+    if (!slot->in_use || !(slot->requested & field)) return nullptr;
+    if (slot->loaded & field) return slot;
+    switch (field) {
+      case KINFO_EXEP:
+        slot->executable_image_file_path = ngs::xproc::exe_from_proc_id(slot->proc_id);
+        break;
+      case KINFO_CWDP:
+        slot->current_working_directory = ngs::xproc::cwd_from_proc_id(slot->proc_id);
+        break;
+      case KINFO_PPID:
+        parent_proc_id_from_proc_id(slot->proc_id, &slot->parent_process_id);
+        break;
+      case KINFO_CPID:
+        slot->child_process_id = ngs::xproc::proc_id_from_parent_proc_id(slot->proc_id);
+        break;
+      case KINFO_ARGV:
+        proc_info_pointers(slot->commandline_buffer, slot->commandline, ngs::xproc::cmdline_from_proc_id, slot->proc_id);
+        break;
+      case KINFO_ENVV:
+        proc_info_pointers(slot->environment_buffer, slot->environment, ngs::xproc::environ_from_proc_id, slot->proc_id);
+        break;
+      #if defined(PROCESS_GUIWINDOW_IMPL)
+      case KINFO_OWID: {
+        WINDOWID *wid = nullptr; int widsize = 0;
+        window_id_from_proc_id(slot->proc_id, &wid, &widsize);
+        if (wid) {
+          slot->owned_window_id_buffer.assign(wid, wid + widsize);
+          free_window_id(wid);
+        }
+        for (std::string &str : slot->owned_window_id_buffer)
+          slot->owned_window_id.push_back((WINDOWID)str.c_str());
+        break;
+      }
+      #endif
+    }
+    slot->loaded |= field;
+    return slot;
+  }
 
   PROCINFO proc_info_from_proc_id(XPROCID proc_id) {
     KINFOFLAGS kinfo_flags = KINFO_EXEP | KINFO_CWDP | KINFO_PPID | KINFO_CPID | KINFO_ARGV | KINFO_ENVV;
@@ -665,96 +931,366 @@ namespace ngs::cproc {
   }
 
   PROCINFO proc_info_from_proc_id_ex(XPROCID proc_id, KINFOFLAGS kinfo_flags) {
-    char *exe = nullptr; if (kinfo_flags & KINFO_EXEP) exe_from_proc_id(proc_id, &exe);
-    char *cwd = nullptr; if (kinfo_flags & KINFO_CWDP) cwd_from_proc_id(proc_id, &cwd);
-    XPROCID ppid = 0;     if (kinfo_flags & KINFO_PPID) parent_proc_id_from_proc_id(proc_id, &ppid);
-    XPROCID *pid = nullptr; int pidsize = 0;
-    if (kinfo_flags & KINFO_CPID) proc_id_from_parent_proc_id(proc_id, &pid, &pidsize);
-    char **cmd = nullptr; int cmdsize = 0;
-    if (kinfo_flags & KINFO_ARGV) cmdline_from_proc_id(proc_id, &cmd, &cmdsize);
-    char **env = nullptr; int envsize = 0;
-    if (kinfo_flags & KINFO_ENVV) environ_from_proc_id(proc_id, &env, &envsize);
+    std::lock_guard<std::mutex> guard(proc_info_mutex);
+    PROCINFO proc_info = 0;
+    if (!proc_info_free.empty()) {
+      proc_info = proc_info_free.back();
+      proc_info_free.pop_back();
+    } else {
+      proc_info = (PROCINFO)proc_info_slots.size();
+      proc_info_slots.emplace_back(new proc_info_slot());
+    }
+    proc_info_slot *slot = proc_info_slots[proc_info].get();
+    std::lock_guard<std::mutex> slot_guard(slot->mutex);
+    slot->proc_id = proc_id;
+    slot->requested = kinfo_flags;
+    slot->loaded = 0;
+    slot->in_use = true;
+    return proc_info;
+  }
+
+  char *executable_image_file_path(PROCINFO proc_info) {
+    proc_info_slot *slot = proc_info_load(proc_info, KINFO_EXEP);
+    return slot ? (char *)slot->executable_image_file_path.c_str() : (char *)"\0";
+  }
+
+  char *current_working_directory(PROCINFO proc_info) {
+    proc_info_slot *slot = proc_info_load(proc_info, KINFO_CWDP);
+    return slot ? (char *)slot->current_working_directory.c_str() : (char *)"\0";
+  }
+
+  XPROCID parent_process_id(PROCINFO proc_info) {
+    proc_info_slot *slot = proc_info_load(proc_info, KINFO_PPID);
+    return slot ? slot->parent_process_id : 0;
+  }
+
+  XPROCID *child_process_id(PROCINFO proc_info) {
+    proc_info_slot *slot = proc_info_load(proc_info, KINFO_CPID);
+    return (slot && !slot->child_process_id.empty()) ? slot->child_process_id.data() : nullptr;
+  }
+
+  XPROCID child_process_id(PROCINFO proc_info, int i) {
+    proc_info_slot *slot = proc_info_load(proc_info, KINFO_CPID);
+    if (!slot || i < 0 || i >= (int)slot->child_process_id.size()) return 0;
+    return slot->child_process_id[i];
+  }
+
+  int child_process_id_length(PROCINFO proc_info) {
+    proc_info_slot *slot = proc_info_load(proc_info, KINFO_CPID);
+    return slot ? (int)slot->child_process_id.size() : 0;
+  }
+
+  char **commandline(PROCINFO proc_info) {
+    proc_info_slot *slot = proc_info_load(proc_info, KINFO_ARGV);
+    return (slot && !slot->commandline.empty()) ? slot->commandline.data() : nullptr;
+  }
+
+  char *commandline(PROCINFO proc_info, int i) {
+    proc_info_slot *slot = proc_info_load(proc_info, KINFO_ARGV);
+    if (!slot || i < 0 || i >= (int)slot->commandline.size()) return nullptr;
+    return slot->commandline[i];
+  }
+
+  int commandline_length(PROCINFO proc_info) {
+    proc_info_slot *slot = proc_info_load(proc_info, KINFO_ARGV);
+    return slot ? (int)slot->commandline.size() : 0;
+  }
+
+  char **environment(PROCINFO proc_info) {
+    proc_info_slot *slot = proc_info_load(proc_info, KINFO_ENVV);
+    return (slot && !slot->environment.empty()) ? slot->environment.data() : nullptr;
+  }
+
+  char *environment(PROCINFO proc_info, int i) {
+    proc_info_slot *slot = proc_info_load(proc_info, KINFO_ENVV);
+    if (!slot || i < 0 || i >= (int)slot->environment.size()) return nullptr;
+    return slot->environment[i];
+  }
+
+  int environment_length(PROCINFO proc_info) {
+    proc_info_slot *slot = proc_info_load(proc_info, KINFO_ENVV);
+    return slot ? (int)slot->environment.size() : 0;
+  }
+
+  #if defined(PROCESS_GUIWINDOW_IMPL)
+  WINDOWID *owned_window_id(PROCINFO proc_info) {
+    proc_info_slot *slot = proc_info_load(proc_info, KINFO_OWID);
+    return (slot && !slot->owned_window_id.empty()) ? slot->owned_window_id.data() : nullptr;
+  }
+
+  WINDOWID owned_window_id(PROCINFO proc_info, int i) {
+    proc_info_slot *slot = proc_info_load(proc_info, KINFO_OWID);
+    if (!slot || i < 0 || i >= (int)slot->owned_window_id.size()) return nullptr;
+    return slot->owned_window_id[i];
+  }
+
+  int owned_window_id_length(PROCINFO proc_info) {
+    proc_info_slot *slot = proc_info_load(proc_info, KINFO_OWID);
+    return slot ? (int)slot->owned_window_id.size() : 0;
+  }
+  #endif
+
+  // clears the slot but keeps its buffers' capacity for the next handle.
+  void free_proc_info(PROCINFO proc_info) {
+    proc_info_slot *slot = proc_info_get(proc_info);
+    if (!slot) return;
+    {
+      std::lock_guard<std::mutex> slot_guard(slot->mutex);
+      if (!slot->in_use) return;
+      slot->in_use = false;
+      slot->executable_image_file_path.clear();
+      slot->current_working_directory.clear();
+      slot->parent_process_id = 0;
+      slot->child_process_id.clear();
+      slot->commandline_buffer.clear();
+      slot->commandline.clear();
+      slot->environment_buffer.clear();
+      slot->environment.clear();
+      #if defined(PROCESS_GUIWINDOW_IMPL)
+      slot->owned_window_id_buffer.clear();
+      slot->owned_window_id.clear();
+      #endif
+    }
+    std::lock_guard<std::mutex> guard(proc_info_mutex);
+    proc_info_free.push_back(proc_info);
+  }
+
+  static std::mutex proc_table_mutex;
+  static std::vector<std::unique_ptr<proc_table_slot>> proc_table_slots;
+  static std::vector<PROCTABLE> proc_table_free;
+
+  static inline proc_table_slot *proc_table_get(PROCTABLE proc_table) {
+    std::lock_guard<std::mutex> guard(proc_table_mutex);
+    if (proc_table < 0 || (std::size_t)proc_table >= proc_table_slots.size()) return nullptr;
+    proc_table_slot *slot = proc_table_slots[proc_table].get();
+    return slot->in_use ? slot : nullptr;
+  }
+
+  // one row per process, filled in a single pass: the pid list is read once,
+  // argv and environ are only counted through one reused buffer, and window
+  // counts come from one window to pid table instead of a scan per process.
+  // KINFO_PPID, KINFO_EXEP, KINFO_CWDP, KINFO_ARGV, KINFO_ENVV and KINFO_OWID
+  // select the columns; the pid column is always present.
+  PROCTABLE proc_table_create(KINFOFLAGS kinfo_flags) {
+    PROCTABLE proc_table = 0;
+    proc_table_slot *slot = nullptr;
+    {
+      std::lock_guard<std::mutex> guard(proc_table_mutex);
+      if (!proc_table_free.empty()) {
+        proc_table = proc_table_free.back();
+        proc_table_free.pop_back();
+      } else {
+        proc_table = (PROCTABLE)proc_table_slots.size();
+        proc_table_slots.emplace_back(new proc_table_slot());
+      }
+      slot = proc_table_slots[proc_table].get();
+    }
+    // the pid, parent, exe and cwd columns all come from one snapshot, so the
+    // table is consistent and the per-process reads use the scan threads.
+    ngs::xproc::proc_snapshot snapshot;
+    slot->process_id = snapshot.proc_id_enum();
+    std::size_t length = slot->process_id.size();
     #if defined(PROCESS_GUIWINDOW_IMPL)
-    WINDOWID *wid = nullptr; int widsize = 0;
-    if (kinfo_flags & KINFO_OWID) window_id_from_proc_id(proc_id, &wid, &widsize);
+    std::unordered_map<XPROCID, int> window_count;
+    if (kinfo_flags & KINFO_OWID) {
+      std::vector<std::pair<std::string, XPROCID>> table = window_proc_id_table();
+      for (std::size_t i = 0; i < table.size(); i++)
+        window_count[table[i].second]++;
+    }
     #endif
-    PROCINFO_STRUCT *proc_info = new PROCINFO_STRUCT();
-    proc_info->executable_image_file_path = exe;
-    proc_info->current_working_directory  = cwd;
-    proc_info->parent_process_id          = ppid;
-    proc_info->child_process_id           = pid;
-    proc_info->child_process_id_length    = pidsize;
-    proc_info->commandline                = cmd;
-    proc_info->commandline_length         = cmdsize;
-    proc_info->environment                = env;
-    proc_info->environment_length         = envsize;
+    std::vector<char> buffer;
+    std::vector<std::string_view> views;
+    for (std::size_t i = 0; i < length; i++) {
+      message_pump();
+      XPROCID proc_id = slot->process_id[i];
+      if (kinfo_flags & KINFO_PPID) {
+        std::vector<XPROCID> ppid = snapshot.parent_proc_id_from_proc_id(proc_id);
+        slot->parent_process_id.push_back(ppid.empty() ? 0 : ppid[0]);
+      }
+      if (kinfo_flags & KINFO_EXEP)
+        slot->executable_image_file_path_buffer.push_back(snapshot.exe_from_proc_id(proc_id));
+      if (kinfo_flags & KINFO_CWDP)
+        slot->current_working_directory_buffer.push_back(snapshot.cwd_from_proc_id(proc_id));
+      if (kinfo_flags & KINFO_ARGV) {
+        ngs::xproc::cmdline_from_proc_id(proc_id, buffer, views);
+        slot->commandline_length.push_back((int)views.size());
+      }
+      if (kinfo_flags & KINFO_ENVV) {
+        ngs::xproc::environ_from_proc_id(proc_id, buffer, views);
+        slot->environment_length.push_back((int)views.size());
+      }
+      #if defined(PROCESS_GUIWINDOW_IMPL)
+      if (kinfo_flags & KINFO_OWID) {
+        auto it = window_count.find(proc_id);
+        slot->owned_window_id_length.push_back((it == window_count.end()) ? 0 : it->second);
+      }
+      #endif
+    }
+    for (std::string &str : slot->executable_image_file_path_buffer)
+      slot->executable_image_file_path.push_back((char *)str.c_str());
+    for (std::string &str : slot->current_working_directory_buffer)
+      slot->current_working_directory.push_back((char *)str.c_str());
+    std::lock_guard<std::mutex> guard(proc_table_mutex);
+    slot->in_use = true;
+    return proc_table;
+  }
+
+  void free_proc_table(PROCTABLE proc_table) {
+    std::lock_guard<std::mutex> guard(proc_table_mutex);
+    if (proc_table < 0 || (std::size_t)proc_table >= proc_table_slots.size()) return;
+    proc_table_slot *slot = proc_table_slots[proc_table].get();
+    if (!slot->in_use) return;
+    slot->in_use = false;
+    slot->process_id.clear();
+    slot->parent_process_id.clear();
+    slot->executable_image_file_path_buffer.clear();
+    slot->executable_image_file_path.clear();
+    slot->current_working_directory_buffer.clear();
+    slot->current_working_directory.clear();
+    slot->commandline_length.clear();
+    slot->environment_length.clear();
     #if defined(PROCESS_GUIWINDOW_IMPL)
-    proc_info->owned_window_id            = wid;
-    proc_info->owned_window_id_length     = widsize;
+    slot->owned_window_id_length.clear();
     #endif
-    procInfoIndex++; proc_info_map[procInfoIndex] = proc_info;
-    return procInfoIndex;
-  }
-
-  char *executable_image_file_path(PROCINFO proc_info) { 
-    return proc_info_map[proc_info]->executable_image_file_path ? proc_info_map[proc_info]->executable_image_file_path : (char *)"\0"; }
-  char *current_working_directory(PROCINFO proc_info) { 
-    return proc_info_map[proc_info]->current_working_directory ? proc_info_map[proc_info]->current_working_directory : (char *)"\0"; }
-  XPROCID parent_process_id(PROCINFO proc_info) { return proc_info_map[proc_info]->parent_process_id; }
-  XPROCID *child_process_id(PROCINFO proc_info) { return proc_info_map[proc_info]->child_process_id; }
-  XPROCID child_process_id(PROCINFO proc_info, int i) { return proc_info_map[proc_info]->child_process_id[i]; }
-  int child_process_id_length(PROCINFO proc_info) { return proc_info_map[proc_info]->child_process_id_length; }
-  char **commandline(PROCINFO proc_info) { return proc_info_map[proc_info]->commandline; }
-  char *commandline(PROCINFO proc_info, int i) { return proc_info_map[proc_info]->commandline[i]; }
-  int commandline_length(PROCINFO proc_info) { return proc_info_map[proc_info]->commandline_length; }
-  char **environment(PROCINFO proc_info) { return proc_info_map[proc_info]->environment; }
-  char *environment(PROCINFO proc_info, int i) { return proc_info_map[proc_info]->environment[i]; }
-  int environment_length(PROCINFO proc_info) { return proc_info_map[proc_info]->environment_length; }
+    proc_table_free.push_back(proc_table);
+  }
+
+  int proc_table_length(PROCTABLE proc_table) {
+    proc_table_slot *slot = proc_table_get(proc_table);
+    return slot ? (int)slot->process_id.size() : 0;
+  }
+
+  // column accessors return nullptr for a dead handle or a column not requested.
+  template<typename T> static inline T *proc_table_column(std::vector<T> &column) {
+    return column.empty() ? nullptr : column.data();
+  }
+
+  XPROCID *proc_table_process_id(PROCTABLE proc_table) {
+    proc_table_slot *slot = proc_table_get(proc_table);
+    return slot ? proc_table_column(slot->process_id) : nullptr;
+  }
+
+  XPROCID *proc_table_parent_process_id(PROCTABLE proc_table) {
+    proc_table_slot *slot = proc_table_get(proc_table);
+    return slot ? proc_table_column(slot->parent_process_id) : nullptr;
+  }
+
+  char **proc_table_executable_image_file_path(PROCTABLE proc_table) {
+    proc_table_slot *slot = proc_table_get(proc_table);
+    return slot ? proc_table_column(slot->executable_image_file_path) : nullptr;
+  }
+
+  char **proc_table_current_working_directory(PROCTABLE proc_table) {
+    proc_table_slot *slot = proc_table_get(proc_table);
+    return slot ? proc_table_column(slot->current_working_directory) : nullptr;
+  }
+
+  int *proc_table_commandline_length(PROCTABLE proc_table) {
+    proc_table_slot *slot = proc_table_get(proc_table);
+    return slot ? proc_table_column(slot->commandline_length) : nullptr;
+  }
+
+  int *proc_table_environment_length(PROCTABLE proc_table) {
+    proc_table_slot *slot = proc_table_get(proc_table);
+    return slot ? proc_table_column(slot->environment_length) : nullptr;
+  }
+
   #if defined(PROCESS_GUIWINDOW_IMPL)
-  WINDOWID *owned_window_id(PROCINFO proc_info) { return proc_info_map[proc_info]->owned_window_id; }
-  WINDOWID owned_window_id(PROCINFO proc_info, int i) { return proc_info_map[proc_info]->owned_window_id[i]; }
-  int owned_window_id_length(PROCINFO proc_info) { return proc_info_map[proc_info]->owned_window_id_length; }
+  int *proc_table_owned_window_id_length(PROCTABLE proc_table) {
+    proc_table_slot *slot = proc_table_get(proc_table);
+    return slot ? proc_table_column(slot->owned_window_id_length) : nullptr;
+  }
   #endif
 
-  void free_proc_info(PROCINFO proc_info) {
-    if (proc_info_map.find(proc_info) == proc_info_map.end()) return;
-    free_proc_id(proc_info_map[proc_info]->child_process_id);
-    free_cmdline(proc_info_map[proc_info]->commandline);
-    free_environ(proc_info_map[proc_info]->environment);
-    #if defined(PROCESS_GUIWINDOW_IMPL)
-    free_window_id(proc_info_map[proc_info]->owned_window_id);
-    #endif
-    delete proc_info_map[proc_info];
-    proc_info_map.erase(proc_info);
+  // PROCLIST handles reuse freed slots the same way PROCINFO and PROCTABLE do.
+  // each list is kept in ascending pid order so two of them can be diffed in one
+  // merge pass.
+  static std::mutex proc_list_mutex;
+  static std::vector<std::unique_ptr<proc_list_slot>> proc_list_slots;
+  static std::vector<PROCLIST> proc_list_free;
+
+  static inline proc_list_slot *proc_list_get(PROCLIST proc_list) {
+    std::lock_guard<std::mutex> guard(proc_list_mutex);
+    if (proc_list < 0 || (std::size_t)proc_list >= proc_list_slots.size()) return nullptr;
+    proc_list_slot *slot = proc_list_slots[proc_list].get();
+    return slot->in_use ? slot : nullptr;
   }
 
   PROCLIST proc_list_create() {
-    XPROCID *proc_id = nullptr; int size = 0;
-    proc_id_enumerate(&proc_id, &size);
-    if (proc_id) {
-      std::vector<XPROCID> res;
-      for (int i = 0; i < size; i++) {
-        message_pump();
-        res.push_back(proc_id[i]);
+    PROCLIST proc_list = 0;
+    proc_list_slot *slot = nullptr;
+    {
+      std::lock_guard<std::mutex> guard(proc_list_mutex);
+      if (!proc_list_free.empty()) {
+        proc_list = proc_list_free.back();
+        proc_list_free.pop_back();
+      } else {
+        proc_list = (PROCLIST)proc_list_slots.size();
+        proc_list_slots.emplace_back(new proc_list_slot());
       }
-      proc_list_vec.push_back(res);
-      free_proc_id(proc_id);
+      slot = proc_list_slots[proc_list].get();
     }
-    procListIndex++;
-    return procListIndex;
+    slot->process_id = ngs::xproc::proc_id_enum();
+    std::sort(slot->process_id.begin(), slot->process_id.end());
+    std::lock_guard<std::mutex> guard(proc_list_mutex);
+    slot->in_use = true;
+    return proc_list;
+  }
+
+  XPROCID *process_id(PROCLIST proc_list) {
+    proc_list_slot *slot = proc_list_get(proc_list);
+    return (slot && !slot->process_id.empty()) ? slot->process_id.data() : nullptr;
   }
 
   XPROCID process_id(PROCLIST proc_list, int i) {
-    std::vector<XPROCID> proc_id = proc_list_vec[proc_list];
-    return proc_id[i];
+    proc_list_slot *slot = proc_list_get(proc_list);
+    if (!slot || i < 0 || i >= (int)slot->process_id.size()) return 0;
+    return slot->process_id[i];
   }
 
   int process_id_length(PROCLIST proc_list) {
-    return (int)proc_list_vec[proc_list].size();
+    proc_list_slot *slot = proc_list_get(proc_list);
+    return slot ? (int)slot->process_id.size() : 0;
+  }
+
+  // pids in new_list but not old_list go to added, the reverse to removed. both
+  // arrays are allocated like proc_id_enumerate's and released with free_proc_id;
+  // an empty side comes back as nullptr with a size of 0.
+  void proc_list_diff(PROCLIST old_list, PROCLIST new_list, XPROCID **added, int *added_size, XPROCID **removed, int *removed_size) {
+    *added = nullptr; *added_size = 0;
+    *removed = nullptr; *removed_size = 0;
+    proc_list_slot *old_slot = proc_list_get(old_list);
+    proc_list_slot *new_slot = proc_list_get(new_list);
+    if (!old_slot || !new_slot) return;
+    const std::vector<XPROCID> &before = old_slot->process_id;
+    const std::vector<XPROCID> &after = new_slot->process_id;
+    std::vector<XPROCID> plus, minus;
+    std::set_difference(after.begin(), after.end(), before.begin(), before.end(), std::back_inserter(plus));
+    std::set_difference(before.begin(), before.end(), after.begin(), after.end(), std::back_inserter(minus));
+    if (!plus.empty()) {
+      *added = (XPROCID *)malloc(sizeof(XPROCID) * plus.size());
+      if (*added) {
+        std::copy(plus.begin(), plus.end(), *added);
+        *added_size = (int)plus.size();
+      }
+    }
+    if (!minus.empty()) {
+      *removed = (XPROCID *)malloc(sizeof(XPROCID) * minus.size());
+      if (*removed) {
+        std::copy(minus.begin(), minus.end(), *removed);
+        *removed_size = (int)minus.size();
+      }
+    }
   }
 
   void free_proc_list(PROCLIST proc_list) {
-    proc_list_vec[proc_list].clear();
+    std::lock_guard<std::mutex> guard(proc_list_mutex);
+    if (proc_list < 0 || (std::size_t)proc_list >= proc_list_slots.size()) return;
+    proc_list_slot *slot = proc_list_slots[proc_list].get();
+    if (!slot->in_use) return;
+    slot->in_use = false;
+    slot->process_id.clear();
+    proc_list_free.push_back(proc_list);
   }
 
   #if !defined(_WIN32)
@@ -762,9 +1298,9 @@ namespace ngs::cproc {
     int p_stdin[2];
     int p_stdout[2];
     XPROCID pid = -1;
-    if (pipe(p_stdin) == -1)
+    if (!ngs::xproc::pipe_cloexec(p_stdin))
       return -1;
-    if (pipe(p_stdout) == -1) {
+    if (!ngs::xproc::pipe_cloexec(p_stdout)) {
       close(p_stdin[0]);
       close(p_stdin[1]);
       return -1;
@@ -782,8 +1318,7 @@ namespace ngs::cproc {
       close(p_stdout[0]);
       dup2(p_stdout[1], 1);
       dup2(p_stdout[1], 2);
-      for (int i = 3; i < 4096; i++)
-        close(i);
+      ngs::xproc::close_fds_from(3);
       setsid();
       execl("/bin/sh", "/bin/sh", "-c", command, nullptr);
       _exit(-1);
@@ -804,61 +1339,195 @@ namespace ngs::cproc {
   }
   #endif
 
-  static inline void output_thread(std::intptr_t file, CPROCID proc_index) {
-    #if !defined(_WIN32)
-    ssize_t nRead = 0; char buffer[BUFSIZ];
-    while ((nRead = read((int)file, buffer, BUFSIZ)) > 0) {
-      buffer[nRead] = '\0';
-    #else
-    DWORD nRead = 0; char buffer[BUFSIZ];
-    while (ReadFile((HANDLE)(void *)file, buffer, BUFSIZ, &nRead, nullptr) && nRead) {
-      message_pump();
-      buffer[nRead] = '\0';
-    #endif
-      std::lock_guard<std::mutex> guard(stdopt_mutex);
-      stdopt_map[proc_index].append(buffer, nRead);
+  static std::string standard_input;
+
+  #if !defined(_WIN32)
+  static inline void process_execute_finish(CPROCID proc_index, std::shared_ptr<executed_process> entry) {
+    entry->close_standard_input();
+    entry->complete = true;
+    executed_processes.release(proc_index, entry);
+  }
+
+  // fork the command and register it; the handle is the pid of the /bin/sh child.
+  static inline CPROCID process_execute_launch(const char *command, int *outfd, std::shared_ptr<executed_process> *entry) {
+    int infd = -1;
+    XPROCID proc_id = process_execute_helper(command, &infd, outfd);
+    if (proc_id == -1) {
+      *outfd = -1;
+      *entry = executed_processes.insert(0);
+      (*entry)->complete = true;
+      return 0;
     }
+    CPROCID proc_index = (CPROCID)proc_id;
+    *entry = executed_processes.insert(proc_index);
+    (*entry)->standard_input = (std::intptr_t)infd;
+    return proc_index;
   }
 
-  static int index = -1;
-  static std::unordered_map<int, XPROCID> child_proc_id;
-  static std::unordered_map<int, bool> proc_did_execute;
-  static std::string standard_input;
+  // multiplexes the standard output of asynchronously executed children over one
+  // poll loop, so more children means more pollfds rather than more threads. once
+  // a child's output hits eof it is reaped, via its pidfd where the kernel has
+  // pidfd_open and by a short poll timeout otherwise. the loop is stopped and
+  // joined on destruction, so it never outlives the statics it works on.
+  class process_executor {
+  public:
+    ~process_executor() {
+      {
+        std::lock_guard<std::mutex> guard(mutex);
+        if (!started) return;
+        stopping = true;
+        char byte = 0;
+        ssize_t unused = write(wakeup[1], &byte, 1);
+        (void)unused;
+      }
+      thread.join();
+      for (child &c : pending) {
+        if (c.outfd != -1) close(c.outfd);
+        if (c.pidfd != -1) close(c.pidfd);
+      }
+      for (int fd : wakeup) close(fd);
+    }
 
-  #if !defined(_WIN32)
-  static inline XPROCID proc_id_from_fork_proc_id(XPROCID proc_id) {
-    XPROCID *pid = nullptr; int pidsize = 0;
-    std::this_thread::sleep_for(std::chrono::milliseconds(5));
-    proc_id_from_parent_proc_id(proc_id, &pid, &pidsize);
-    if (pid) { if (pidsize) { proc_id = pid[pidsize - 1]; }
-    free_proc_id(pid); }
-    return proc_id;
+    void watch(CPROCID proc_index, int outfd, std::shared_ptr<executed_process> entry) {
+      int pidfd = -1;
+      #if defined(SYS_pidfd_open)
+      pidfd = (int)syscall(SYS_pidfd_open, (pid_t)proc_index, 0);
+      #endif
+      std::lock_guard<std::mutex> guard(mutex);
+      if (!started) {
+        if (!ngs::xproc::pipe_cloexec(wakeup)) {
+          watch_blocking(proc_index, outfd, pidfd, entry);
+          return;
+        }
+        for (int fd : wakeup)
+          fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+        thread = std::thread(&process_executor::run, this);
+        started = true;
+      }
+      fcntl(outfd, F_SETFL, fcntl(outfd, F_GETFL, 0) | O_NONBLOCK);
+      pending.push_back({ proc_index, outfd, pidfd, 0, entry });
+      char byte = 0;
+      ssize_t unused = write(wakeup[1], &byte, 1);
+      (void)unused;
+    }
+
+  private:
+    struct child {
+      CPROCID proc_index;
+      int outfd;
+      int pidfd;
+      std::size_t slot;
+      std::shared_ptr<executed_process> entry;
+    };
+
+    std::mutex mutex;
+    std::vector<child> pending;
+    int wakeup[2] = { -1, -1 };
+    bool started = false;
+    bool stopping = false;
+    std::thread thread;
+
+    // only reached if the wakeup pipe cannot be created.
+    static void watch_blocking(CPROCID proc_index, int outfd, int pidfd, std::shared_ptr<executed_process> entry) {
+      std::thread([proc_index, outfd, pidfd, entry]() {
+        char buffer[BUFSIZ]; ssize_t nread = 0;
+        while ((nread = read(outfd, buffer, BUFSIZ)) > 0 || (nread == -1 && errno == EINTR))
+          if (nread > 0) entry->standard_output.append(buffer, (std::size_t)nread);
+        close(outfd);
+        if (pidfd != -1) close(pidfd);
+        int status = 0;
+        while (waitpid((pid_t)proc_index, &status, 0) == -1 && errno == EINTR);
+        process_execute_finish(proc_index, entry);
+      }).detach();
+    }
+
+    static bool reap(child &c) {
+      int status = 0;
+      pid_t result = waitpid((pid_t)c.proc_index, &status, WNOHANG);
+      if (result == 0 || (result == -1 && errno == EINTR)) return false;
+      if (c.pidfd != -1) close(c.pidfd);
+      process_execute_finish(c.proc_index, c.entry);
+      return true;
+    }
+
+    void run() {
+      std::vector<child> children;
+      std::vector<struct pollfd> fds;
+      std::vector<char> buffer(65536);
+      int backoff = 0;
+      while (true) {
+        bool reaping = false;
+        fds.clear();
+        fds.push_back({ wakeup[0], POLLIN, 0 });
+        for (child &c : children) {
+          c.slot = 0;
+          int fd = (c.outfd != -1) ? c.outfd : c.pidfd;
+          if (fd == -1) { reaping = true; continue; }
+          c.slot = fds.size();
+          fds.push_back({ fd, POLLIN, 0 });
+        }
+        if (poll(fds.data(), (nfds_t)fds.size(), reaping ? 5 : -1) == -1) {
+          if (errno == EINTR) continue;
+          // a persistent error (ENOMEM, or more fds than RLIMIT_NOFILE allows)
+          // would otherwise spin; wait longer each time, up to a second.
+          backoff = backoff ? std::min(backoff * 2, 1000) : 10;
+          std::this_thread::sleep_for(std::chrono::milliseconds(backoff));
+          std::lock_guard<std::mutex> guard(mutex);
+          if (stopping) break;
+          continue;
+        }
+        backoff = 0;
+        if (fds[0].revents & POLLIN) {
+          while (read(wakeup[0], buffer.data(), buffer.size()) > 0);
+          std::lock_guard<std::mutex> guard(mutex);
+          if (stopping) break;
+          children.insert(children.end(), pending.begin(), pending.end());
+          pending.clear();
+        }
+        for (std::size_t i = 0; i < children.size();) {
+          child &c = children[i];
+          bool ready = c.slot && fds[c.slot].revents;
+          if (ready && c.outfd != -1) {
+            ssize_t nread = read(c.outfd, buffer.data(), buffer.size());
+            if (nread > 0) {
+              c.entry->standard_output.append(buffer.data(), (std::size_t)nread);
+            } else if (nread == 0 || (errno != EAGAIN && errno != EINTR)) {
+              close(c.outfd);
+              c.outfd = -1;
+            }
+          }
+          if (c.outfd == -1 && (ready || c.pidfd == -1) && reap(c)) {
+            children[i] = std::move(children.back());
+            children.pop_back();
+            continue;
+          }
+          i++;
+        }
+      }
+      for (child &c : children) {
+        if (c.outfd != -1) close(c.outfd);
+        if (c.pidfd != -1) close(c.pidfd);
+      }
+    }
+  };
+
+  static const int process_executor_max = 16;
+  static process_executor process_executors[process_executor_max];
+  static std::atomic<int> process_executor_count(1);
+  static std::atomic<unsigned> process_executor_next(0);
+  #else
+  static inline void output_thread(std::intptr_t file, std::shared_ptr<executed_process> entry) {
+    DWORD nRead = 0; char buffer[BUFSIZ];
+    while (ReadFile((HANDLE)(void *)file, buffer, BUFSIZ, &nRead, nullptr) && nRead) {
+      message_pump();
+      entry->standard_output.append(buffer, (std::size_t)nRead);
+    }
   }
-  #endif
 
-  CPROCID process_execute(const char *command) {
-    index++;
-    #if !defined(_WIN32)
-    int infd = 0, outfd = 0;
-    XPROCID proc_id = 0, fork_proc_id = 0, wait_proc_id = 0;
-    fork_proc_id = process_execute_helper(command, &infd, &outfd);
-    proc_id = fork_proc_id; wait_proc_id = proc_id;
-    std::this_thread::sleep_for(std::chrono::milliseconds(5));
-    if (fork_proc_id != -1) {
-      while ((proc_id = proc_id_from_fork_proc_id(proc_id)) == wait_proc_id) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(5));
-        int status; wait_proc_id = waitpid(fork_proc_id, &status, WNOHANG);
-        char **cmd = nullptr; int cmdsize; cmdline_from_proc_id(fork_proc_id, &cmd, &cmdsize);
-        if (cmd) { if (cmdsize && strcmp(cmd[0], "/bin/sh") == 0) {
-        if (wait_proc_id > 0) proc_id = wait_proc_id; } free_cmdline(cmd); }
-      }
-    } else { proc_id = 0; }
-    child_proc_id[index] = proc_id; std::this_thread::sleep_for(std::chrono::milliseconds(5));
-    proc_did_execute[index] = true; CPROCID proc_index = (CPROCID)proc_id;
-    stdipt_map[proc_index] = (std::intptr_t)infd;
-    std::thread opt_thread(output_thread, (std::intptr_t)outfd, proc_index);
-    opt_thread.join();
-    #else
+  // runs the command to completion; the handle is reported through started as
+  // soon as its registry entry exists, which is what process_execute_async waits on.
+  static inline CPROCID process_execute_worker(std::string command, std::promise<CPROCID> *started) {
+    std::shared_ptr<executed_process> entry;
     std::wstring wstr_command = widen(command); bool proceed = true;
     wchar_t *cwstr_command = new wchar_t[wstr_command.length() + 1]();
     wcsncpy_s(cwstr_command, wstr_command.length() + 1, wstr_command.c_str(), wstr_command.length() + 1);
@@ -866,10 +1535,21 @@ namespace ngs::cproc {
     HANDLE stdout_read = nullptr; HANDLE stdout_write = nullptr;
     SECURITY_ATTRIBUTES sa = { sizeof(SECURITY_ATTRIBUTES), nullptr, true };
     proceed = CreatePipe(&stdin_read, &stdin_write, &sa, 0);
-    if (proceed == false) return 0;
-    SetHandleInformation(stdin_write, HANDLE_FLAG_INHERIT, 0);
-    proceed = CreatePipe(&stdout_read, &stdout_write, &sa, 0);
-    if (proceed == false) return 0;
+    if (proceed) {
+      SetHandleInformation(stdin_write, HANDLE_FLAG_INHERIT, 0);
+      proceed = CreatePipe(&stdout_read, &stdout_write, &sa, 0);
+      if (!proceed) {
+        CloseHandle(stdin_read);
+        CloseHandle(stdin_write);
+      }
+    }
+    if (!proceed) {
+      delete[] cwstr_command;
+      entry = executed_processes.insert(0);
+      entry->complete = true;
+      if (started) started->set_value(0);
+      return 0;
+    }
     STARTUPINFOW si;
     ZeroMemory(&si, sizeof(si));
     si.cb = sizeof(STARTUPINFOW);
@@ -880,88 +1560,447 @@ namespace ngs::cproc {
     PROCESS_INFORMATION pi; ZeroMemory(&pi, sizeof(pi)); CPROCID proc_index = 0;
     BOOL success = CreateProcessW(nullptr, cwstr_command, nullptr, nullptr, true, CREATE_NO_WINDOW, nullptr, nullptr, &si, &pi);
     delete[] cwstr_command;
+    CloseHandle(stdout_write);
+    CloseHandle(stdin_read);
     if (success) {
-      CloseHandle(stdout_write);
-      CloseHandle(stdin_read);
-      XPROCID proc_id = pi.dwProcessId; child_proc_id[index] = proc_id; proc_index = (CPROCID)proc_id;
-      std::this_thread::sleep_for(std::chrono::milliseconds(5)); proc_did_execute[index] = true;
-      stdipt_map[proc_index] = (std::intptr_t)(void *)stdin_write;
+      XPROCID proc_id = pi.dwProcessId; proc_index = (CPROCID)proc_id;
+      entry = executed_processes.insert(proc_index);
+      entry->standard_input = (std::intptr_t)(void *)stdin_write;
+      if (started) started->set_value(proc_index);
       HANDLE wait_handles[] = { pi.hProcess, stdout_read };
-      std::thread opt_thread(output_thread, (std::intptr_t)(void *)stdout_read, proc_index);
+      std::thread opt_thread(output_thread, (std::intptr_t)(void *)stdout_read, entry);
       while (MsgWaitForMultipleObjects(2, wait_handles, false, 5, QS_ALLEVENTS) != WAIT_OBJECT_0) {
         message_pump();
       }
       opt_thread.join();
       CloseHandle(pi.hProcess);
       CloseHandle(pi.hThread);
-      CloseHandle(stdout_read);
-      CloseHandle(stdin_write);
     } else {
-      proc_did_execute[index] = true;
-      child_proc_id[index] = 0;
+      CloseHandle(stdin_write);
+      entry = executed_processes.insert(proc_index);
+      if (started) started->set_value(proc_index);
     }
-    #endif
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
-    complete_map[proc_index] = true;
+    CloseHandle(stdout_read);
+    entry->close_standard_input();
+    entry->complete = true;
+    executed_processes.release(proc_index, entry);
+    return proc_index;
+  }
+  #endif
+
+  CPROCID process_execute(const char *command) {
+    #if !defined(_WIN32)
+    int outfd = -1; std::shared_ptr<executed_process> entry;
+    CPROCID proc_index = process_execute_launch(command, &outfd, &entry);
+    if (outfd == -1) return proc_index;
+    char buffer[BUFSIZ]; ssize_t nread = 0;
+    while ((nread = read(outfd, buffer, BUFSIZ)) > 0 || (nread == -1 && errno == EINTR))
+      if (nread > 0) entry->standard_output.append(buffer, (std::size_t)nread);
+    close(outfd);
+    int status = 0;
+    while (waitpid((pid_t)proc_index, &status, 0) == -1 && errno == EINTR);
+    process_execute_finish(proc_index, entry);
     return proc_index;
+    #else
+    return process_execute_worker(command, nullptr);
+    #endif
   }
 
   CPROCID process_execute_async(const char *command) {
-    int prevIndex = index;
-    std::thread proc_thread(process_execute, command);
-    while (prevIndex == index) {
-      message_pump();
-      std::this_thread::sleep_for(std::chrono::milliseconds(5));
-    }
-    while (proc_did_execute.find(index) == proc_did_execute.end() || !proc_did_execute[index]) {
+    #if !defined(_WIN32)
+    int outfd = -1; std::shared_ptr<executed_process> entry;
+    CPROCID proc_index = process_execute_launch(command, &outfd, &entry);
+    if (outfd == -1) return proc_index;
+    unsigned executor = process_executor_next++ % (unsigned)process_executor_count.load();
+    process_executors[executor].watch(proc_index, outfd, entry);
+    return proc_index;
+    #else
+    std::promise<CPROCID> started;
+    std::future<CPROCID> proc_index = started.get_future();
+    std::thread proc_thread([command = std::string(command), started = std::move(started)]() mutable {
+      process_execute_worker(command, &started);
+    });
+    while (proc_index.wait_for(std::chrono::milliseconds(5)) != std::future_status::ready) {
       message_pump();
-      std::this_thread::sleep_for(std::chrono::milliseconds(5));
     }
-    CPROCID proc_index = (CPROCID)child_proc_id[index];
-    complete_map[proc_index] = false;
+    CPROCID result = proc_index.get();
     proc_thread.detach();
-    return proc_index;
+    return result;
+    #endif
+  }
+
+  // spread asynchronously executed children over up to this many poll loops.
+  bool process_execute_set_executor_count(int count) {
+    #if !defined(_WIN32)
+    if (count < 1 || count > process_executor_max) return false;
+    process_executor_count = count;
+    return true;
+    #else
+    return false;
+    #endif
   }
 
   ssize_t executed_process_write_to_standard_input(CPROCID proc_index, const char *input) {
-    if (stdipt_map.find(proc_index) == stdipt_map.end()) return -1;
-    std::string s = input;
-    std::vector<char> v(s.length());
-    std::copy(s.c_str(), s.c_str() + s.length(), v.begin());
+    std::shared_ptr<executed_process> entry = executed_processes.find(proc_index);
+    if (!entry || entry->input_freed) return -1;
+    std::lock_guard<std::mutex> guard(entry->input_mutex);
+    if (entry->standard_input == -1) return -1;
+    std::size_t length = strlen(input);
     #if !defined(_WIN32)
-    ssize_t nwritten = -1;
-    lseek((int)stdipt_map[proc_index], 0, SEEK_END);
-    nwritten = write((int)stdipt_map[proc_index], &v[0], v.size());
-    return nwritten;
+    return write((int)entry->standard_input, input, length);
     #else
     DWORD dwwritten = -1;
-    SetFilePointer((HANDLE)(void *)stdipt_map[proc_index], 0, NULL, FILE_END);
-    WriteFile((HANDLE)(void *)stdipt_map[proc_index], &v[0], (DWORD)v.size(), &dwwritten, nullptr);
+    SetFilePointer((HANDLE)(void *)entry->standard_input, 0, NULL, FILE_END);
+    WriteFile((HANDLE)(void *)entry->standard_input, input, (DWORD)length, &dwwritten, nullptr);
     return (ssize_t)dwwritten;
     #endif
   }
 
   const char *executed_process_read_from_standard_output(CPROCID proc_index) {
-    if (stdopt_map.find(proc_index) == stdopt_map.end()) return "\0";
-    std::lock_guard<std::mutex> guard(stdopt_mutex);
-    return stdopt_map.find(proc_index)->second.c_str();
+    std::shared_ptr<executed_process> entry = executed_processes.find(proc_index);
+    if (!entry || entry->output_freed) return "\0";
+    return entry->standard_output.snapshot();
+  }
+
+  ssize_t executed_process_read_from_standard_output_incremental(CPROCID proc_index, char *buffer, std::size_t size) {
+    std::shared_ptr<executed_process> entry = executed_processes.find(proc_index);
+    if (!entry || entry->output_freed) return -1;
+    return (ssize_t)entry->standard_output.read_incremental(buffer, size);
   }
 
   bool free_executed_process_standard_input(CPROCID proc_index) {
-    if (stdipt_map.find(proc_index) == stdipt_map.end()) return false;
-    stdipt_map.erase(proc_index);
+    std::shared_ptr<executed_process> entry = executed_processes.find(proc_index);
+    if (!entry || entry->input_freed.exchange(true)) return false;
+    entry->close_standard_input();
+    executed_processes.release(proc_index, entry);
     return true;
   }
 
   bool free_executed_process_standard_output(CPROCID proc_index) {
-    if (stdopt_map.find(proc_index) == stdopt_map.end()) return false;
-    stdopt_map.erase(proc_index);
+    std::shared_ptr<executed_process> entry = executed_processes.find(proc_index);
+    if (!entry || entry->output_freed.exchange(true)) return false;
+    executed_processes.release(proc_index, entry);
     return true;
   }
 
   bool completion_status_from_executed_process(CPROCID proc_index) {
-    if (complete_map.find(proc_index) == complete_map.end()) return false;
-    return complete_map.find(proc_index)->second;
+    return executed_processes.completed(proc_index);
+  }
+
+  #if !defined(_WIN32)
+  // delivers process start and exit events to one callback from its own thread.
+  // on linux it subscribes to the kernel proc connector, which sees every fork
+  // and exit system-wide but needs CAP_NET_ADMIN. without it, pids registered
+  // with proc_watch_add are watched through pidfds for immediate exits, and the
+  // process table is diffed every poll interval to catch everything else.
+  class process_watcher {
+  public:
+    ~process_watcher() {
+      stop();
+    }
+
+    bool start(PROCWATCH_CALLBACK callback, void *data) {
+      std::lock_guard<std::mutex> guard(mutex);
+      if (current) return false;
+      std::shared_ptr<session> s = std::make_shared<session>();
+      if (!ngs::xproc::pipe_cloexec(s->wakeup)) return false;
+      for (int fd : s->wakeup)
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+      s->callback = callback;
+      s->data = data;
+      s->interval = interval.load();
+      s->connector = session::connector_open();
+      if (s->connector == -1) {
+        std::vector<XPROCID> proc_id = ngs::xproc::proc_id_enum();
+        s->known.insert(proc_id.begin(), proc_id.end());
+      }
+      s->running = true;
+      thread = std::thread(&session::run, s);
+      current = s;
+      return true;
+    }
+
+    // from the callback the watcher thread can't join itself, so it is detached
+    // and finishes once the callback returns; its session closes with it.
+    void stop() {
+      std::shared_ptr<session> s;
+      std::thread t;
+      {
+        std::lock_guard<std::mutex> guard(mutex);
+        if (!current) return;
+        s.swap(current);
+        t.swap(thread);
+      }
+      {
+        std::lock_guard<std::mutex> guard(s->mutex);
+        s->running = false;
+      }
+      s->wake();
+      if (t.get_id() == std::this_thread::get_id()) t.detach();
+      else t.join();
+    }
+
+    bool add(XPROCID proc_id) {
+      std::lock_guard<std::mutex> guard(mutex);
+      if (!current || proc_id <= 0) return false;
+      return current->add(proc_id);
+    }
+
+    bool system_wide() {
+      std::lock_guard<std::mutex> guard(mutex);
+      return current && current->connector != -1;
+    }
+
+    void set_interval(int milliseconds) {
+      std::lock_guard<std::mutex> guard(mutex);
+      interval = (milliseconds < 1) ? 1 : milliseconds;
+      if (current) current->interval = interval.load();
+    }
+
+  private:
+    // everything one start() to stop() run uses. the thread holds its own
+    // reference, so a detached thread never touches the watcher again.
+    struct session {
+      std::mutex mutex;
+      bool running = false;
+      PROCWATCH_CALLBACK callback = nullptr;
+      void *data = nullptr;
+      int wakeup[2] = { -1, -1 };
+      int connector = -1;
+      std::atomic<int> interval { 250 };
+      std::unordered_map<XPROCID, int> pidfds;
+      std::unordered_set<XPROCID> known;
+      std::unordered_set<XPROCID> exited;
+
+      ~session() {
+        if (connector != -1) close(connector);
+        for (auto &watched : pidfds) {
+          if (watched.second != -1) close(watched.second);
+        }
+        for (int fd : wakeup) {
+          if (fd != -1) close(fd);
+        }
+      }
+
+      void wake() {
+        char byte = 0;
+        ssize_t unused = write(wakeup[1], &byte, 1);
+        (void)unused;
+      }
+
+      bool add(XPROCID proc_id) {
+        std::lock_guard<std::mutex> guard(mutex);
+        if (connector != -1) return true;
+        if (pidfds.find(proc_id) != pidfds.end()) return true;
+        int pidfd = -1;
+        #if defined(SYS_pidfd_open)
+        pidfd = (int)syscall(SYS_pidfd_open, (pid_t)proc_id, 0);
+        #endif
+        pidfds[proc_id] = pidfd;
+        wake();
+        return true;
+      }
+
+      static int connector_open() {
+        #if defined(__linux__)
+        int fd = socket(PF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_CONNECTOR);
+        if (fd == -1) return -1;
+        struct sockaddr_nl addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.nl_family = AF_NETLINK;
+        addr.nl_groups = CN_IDX_PROC;
+        addr.nl_pid = 0;
+        if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+          close(fd);
+          return -1;
+        }
+        // nlmsghdr, then cn_msg, then the listen op as the message payload.
+        alignas(struct nlmsghdr) char request[NLMSG_SPACE(sizeof(struct cn_msg) + sizeof(enum proc_cn_mcast_op))];
+        memset(request, 0, sizeof(request));
+        struct nlmsghdr *header = (struct nlmsghdr *)request;
+        header->nlmsg_len = NLMSG_LENGTH(sizeof(struct cn_msg) + sizeof(enum proc_cn_mcast_op));
+        header->nlmsg_type = NLMSG_DONE;
+        header->nlmsg_pid = 0;
+        struct cn_msg *message = (struct cn_msg *)NLMSG_DATA(header);
+        message->id.idx = CN_IDX_PROC;
+        message->id.val = CN_VAL_PROC;
+        message->len = sizeof(enum proc_cn_mcast_op);
+        enum proc_cn_mcast_op op = PROC_CN_MCAST_LISTEN;
+        memcpy(message->data, &op, sizeof(op));
+        if (send(fd, request, header->nlmsg_len, 0) == -1) {
+          close(fd);
+          return -1;
+        }
+        return fd;
+        #else
+        return -1;
+        #endif
+      }
+
+      // nothing is delivered once stop() has been called.
+      void emit(XPROCID proc_id, int event) {
+        {
+          std::lock_guard<std::mutex> guard(mutex);
+          if (!running) return;
+        }
+        if (callback) callback(proc_id, event, data);
+      }
+
+      #if defined(__linux__)
+      void connector_read() {
+        alignas(struct nlmsghdr) char buffer[4096];
+        ssize_t size = recv(connector, buffer, sizeof(buffer), MSG_DONTWAIT);
+        if (size <= 0) return;
+        for (struct nlmsghdr *header = (struct nlmsghdr *)buffer; NLMSG_OK(header, (unsigned)size); header = NLMSG_NEXT(header, size)) {
+          if (header->nlmsg_type != NLMSG_DONE) continue;
+          struct cn_msg *message = (struct cn_msg *)NLMSG_DATA(header);
+          if (message->id.idx != CN_IDX_PROC || message->id.val != CN_VAL_PROC) continue;
+          struct proc_event *event = (struct proc_event *)message->data;
+          // only whole processes: a new thread shows up as a fork with pid != tgid.
+          if (event->what == proc_event::PROC_EVENT_FORK &&
+            event->event_data.fork.child_pid == event->event_data.fork.child_tgid) {
+            emit((XPROCID)event->event_data.fork.child_tgid, PROCWATCH_START);
+          } else if (event->what == proc_event::PROC_EVENT_EXIT &&
+            event->event_data.exit.process_pid == event->event_data.exit.process_tgid) {
+            emit((XPROCID)event->event_data.exit.process_tgid, PROCWATCH_EXIT);
+          }
+        }
+      }
+      #endif
+
+      // a pid reported as exited through its pidfd stays listed in the process
+      // table until its parent reaps it, so keep it out of the diff until then.
+      void table_diff() {
+        std::vector<XPROCID> proc_id = ngs::xproc::proc_id_enum();
+        std::unordered_set<XPROCID> current(proc_id.begin(), proc_id.end());
+        for (XPROCID pid : proc_id) {
+          if (known.find(pid) == known.end() && exited.find(pid) == exited.end())
+            emit(pid, PROCWATCH_START);
+        }
+        for (XPROCID pid : known) {
+          if (current.find(pid) == current.end())
+            emit(pid, PROCWATCH_EXIT);
+        }
+        for (auto it = exited.begin(); it != exited.end();) {
+          if (current.find(*it) == current.end()) {
+            current.erase(*it);
+            it = exited.erase(it);
+          } else {
+            current.erase(*it);
+            it++;
+          }
+        }
+        known.swap(current);
+      }
+
+      static void run(std::shared_ptr<session> s) {
+        std::vector<struct pollfd> fds;
+        std::vector<XPROCID> slots;
+        auto next_diff = std::chrono::steady_clock::now() + std::chrono::milliseconds(s->interval);
+        while (true) {
+          fds.clear();
+          slots.clear();
+          fds.push_back({ s->wakeup[0], POLLIN, 0 });
+          {
+            std::lock_guard<std::mutex> guard(s->mutex);
+            if (!s->running) return;
+            if (s->connector != -1) fds.push_back({ s->connector, POLLIN, 0 });
+            for (auto &watched : s->pidfds) {
+              if (watched.second == -1) continue;
+              fds.push_back({ watched.second, POLLIN, 0 });
+              slots.push_back(watched.first);
+            }
+          }
+          int timeout = -1;
+          if (s->connector == -1) {
+            auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(next_diff - std::chrono::steady_clock::now());
+            timeout = (remaining.count() > 0) ? (int)remaining.count() : 0;
+          }
+          if (poll(fds.data(), (nfds_t)fds.size(), timeout) == -1 && errno != EINTR)
+            continue;
+          if (fds[0].revents & POLLIN) {
+            char buffer[64];
+            while (read(s->wakeup[0], buffer, sizeof(buffer)) > 0);
+          }
+          std::size_t first = 1;
+          #if defined(__linux__)
+          if (s->connector != -1) {
+            if (fds[1].revents & POLLIN) s->connector_read();
+            first = 2;
+          }
+          #endif
+          for (std::size_t i = first; i < fds.size(); i++) {
+            if (!fds[i].revents) continue;
+            XPROCID pid = slots[i - first];
+            {
+              std::lock_guard<std::mutex> guard(s->mutex);
+              close(s->pidfds[pid]);
+              s->pidfds.erase(pid);
+            }
+            // started and exited between two diffs: report both so no exit arrives unannounced.
+            if (!s->known.erase(pid)) s->emit(pid, PROCWATCH_START);
+            s->exited.insert(pid);
+            s->emit(pid, PROCWATCH_EXIT);
+          }
+          if (s->connector == -1 && std::chrono::steady_clock::now() >= next_diff) {
+            {
+              std::lock_guard<std::mutex> guard(s->mutex);
+              // watched pids without a pidfd are only seen by the diff.
+              for (auto it = s->pidfds.begin(); it != s->pidfds.end();) {
+                if (it->second == -1 && !proc_id_exists(it->first)) it = s->pidfds.erase(it);
+                else it++;
+              }
+            }
+            s->table_diff();
+            next_diff = std::chrono::steady_clock::now() + std::chrono::milliseconds(s->interval);
+          }
+        }
+      }
+    };
+
+    std::mutex mutex;
+    std::thread thread;
+    std::shared_ptr<session> current;
+    std::atomic<int> interval { 250 };
+  };
+
+  static process_watcher proc_watcher;
+  #endif
+
+  bool proc_watch_start(PROCWATCH_CALLBACK callback, void *data) {
+    #if !defined(_WIN32)
+    return proc_watcher.start(callback, data);
+    #else
+    return false;
+    #endif
+  }
+
+  bool proc_watch_add(XPROCID proc_id) {
+    #if !defined(_WIN32)
+    return proc_watcher.add(proc_id);
+    #else
+    return false;
+    #endif
+  }
+
+  bool proc_watch_is_system_wide() {
+    #if !defined(_WIN32)
+    return proc_watcher.system_wide();
+    #else
+    return false;
+    #endif
+  }
+
+  void proc_watch_set_interval(int milliseconds) {
+    #if !defined(_WIN32)
+    proc_watcher.set_interval(milliseconds);
+    #endif
+  }
+
+  void proc_watch_stop() {
+    #if !defined(_WIN32)
+    proc_watcher.stop();
+    #endif
   }
 
   const char *current_process_read_from_standard_input() {
@@ -26,6 +26,8 @@
 
 #pragma once
 
+#include <cstddef>
+
 #if defined(_WIN32)
 #if defined(_MSC_VER)
 #include <BaseTsd.h>
@@ -53,7 +55,11 @@ namespace ngs::cproc {
   #endif
   #define PROCLIST int
   #define PROCINFO int
+  #define PROCTABLE int
   #define KINFOFLAGS int
+  #define PROCWATCH_START 1
+  #define PROCWATCH_EXIT 2
+  typedef void (*PROCWATCH_CALLBACK)(XPROCID proc_id, int event, void *data);
   #define KINFO_EXEP 0x1000
   #define KINFO_CWDP 0x2000
   #define KINFO_PPID 0x0100
@@ -100,9 +106,11 @@ namespace ngs::cproc {
   PROCINFO proc_info_from_proc_id_ex(XPROCID proc_id, KINFOFLAGS kinfo_flags);
   void free_proc_info(PROCINFO proc_info);
   PROCLIST proc_list_create();
+  XPROCID *process_id(PROCLIST proc_list);
   XPROCID process_id(PROCLIST proc_list, int i);
   int process_id_length(PROCLIST proc_list);
-  void free_proc_list(PROCINFO proc_info);
+  void proc_list_diff(PROCLIST old_list, PROCLIST new_list, XPROCID **added, int *added_size, XPROCID **removed, int *removed_size);
+  void free_proc_list(PROCLIST proc_list);
   #if defined(PROCESS_GUIWINDOW_IMPL)
   WINDOWID window_id_from_native_window(WINDOW window);
   WINDOW native_window_from_window_id(WINDOWID winid);
@@ -134,13 +142,36 @@ namespace ngs::cproc {
   int owned_window_id_length(PROCINFO proc_info);
   #endif
 
+  PROCTABLE proc_table_create(KINFOFLAGS kinfo_flags);
+  void free_proc_table(PROCTABLE proc_table);
+  int proc_table_length(PROCTABLE proc_table);
+  XPROCID *proc_table_process_id(PROCTABLE proc_table);
+  XPROCID *proc_table_parent_process_id(PROCTABLE proc_table);
+  char **proc_table_executable_image_file_path(PROCTABLE proc_table);
+  char **proc_table_current_working_directory(PROCTABLE proc_table);
+  int *proc_table_commandline_length(PROCTABLE proc_table);
+  int *proc_table_environment_length(PROCTABLE proc_table);
+  #if defined(PROCESS_GUIWINDOW_IMPL)
+  int *proc_table_owned_window_id_length(PROCTABLE proc_table);
+  #endif
+
   CPROCID process_execute(const char *command);
   CPROCID process_execute_async(const char *command);
+  bool process_execute_set_executor_count(int count);
   ssize_t executed_process_write_to_standard_input(CPROCID proc_index, const char *input);
   const char *executed_process_read_from_standard_output(CPROCID proc_index);
+  ssize_t executed_process_read_from_standard_output_incremental(CPROCID proc_index, char *buffer, std::size_t size);
   bool free_executed_process_standard_input(CPROCID proc_index);
   bool free_executed_process_standard_output(CPROCID proc_index);
   bool completion_status_from_executed_process(CPROCID proc_index);
   const char *current_process_read_from_standard_input();
 
+  // the callback runs on the watcher's thread; it may call proc_watch_stop,
+  // and no events are delivered once proc_watch_stop has been called.
+  bool proc_watch_start(PROCWATCH_CALLBACK callback, void *data);
+  bool proc_watch_add(XPROCID proc_id);
+  bool proc_watch_is_system_wide();
+  void proc_watch_set_interval(int milliseconds);
+  void proc_watch_stop();
+
 } // namespace ngs::cproc
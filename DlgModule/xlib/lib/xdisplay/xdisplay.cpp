@@ -0,0 +1,81 @@
+/*
+
+ MIT License
+ 
+ Copyright © 2021-2022 Samuel Venable
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ 
+*/
+
+#include "xdisplay.hpp"
+
+namespace {
+
+  struct {
+    const char *name;
+    bool only_if_exists;
+  } const atom_names[ngs::xdisplay::ATOM_COUNT] = {
+    { "_NET_WM_PID", true },
+    { "_NET_WM_NAME", false },
+    { "_NET_WM_ICON", true },
+    { "_NET_CLIENT_LIST_STACKING", true },
+    { "UTF8_STRING", false }
+  };
+
+  std::recursive_mutex display_mutex;
+  Display *display = nullptr;
+  Atom atom_cache[ngs::xdisplay::ATOM_COUNT] = { None };
+
+  int x_error_handler_impl(Display *display, XErrorEvent *event) {
+    return 0;
+  }
+
+  int x_io_error_handler_impl(Display *display) {
+    return 0;
+  }
+
+} // anonymous namespace
+
+namespace ngs::xdisplay {
+
+  std::unique_lock<std::recursive_mutex> display_lock() {
+    return std::unique_lock<std::recursive_mutex>(display_mutex);
+  }
+
+  Display *display_get_shared() {
+    std::lock_guard<std::recursive_mutex> guard(display_mutex);
+    if (!display) {
+      XSetErrorHandler(x_error_handler_impl);
+      XSetIOErrorHandler(x_io_error_handler_impl);
+      display = XOpenDisplay(nullptr);
+    }
+    return display;
+  }
+
+  Atom atom_get_cached(ATOM atom) {
+    std::lock_guard<std::recursive_mutex> guard(display_mutex);
+    // atoms interned with only_if_exists stay None until some client creates them, so keep retrying.
+    if (atom_cache[atom] == None && display_get_shared()) {
+      atom_cache[atom] = XInternAtom(display, atom_names[atom].name, atom_names[atom].only_if_exists);
+    }
+    return atom_cache[atom];
+  }
+
+} // namespace ngs::xdisplay
@@ -0,0 +1,49 @@
+/*
+
+ MIT License
+ 
+ Copyright © 2021-2022 Samuel Venable
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ 
+*/
+
+#pragma once
+
+#include <mutex>
+
+#include <X11/Xlib.h>
+
+namespace ngs::xdisplay {
+
+  enum ATOM {
+    NET_WM_PID,
+    NET_WM_NAME,
+    NET_WM_ICON,
+    NET_CLIENT_LIST_STACKING,
+    UTF8_STRING,
+    ATOM_COUNT
+  };
+
+  // all access to the shared connection must happen while holding this lock.
+  std::unique_lock<std::recursive_mutex> display_lock();
+  Display *display_get_shared();
+  Atom atom_get_cached(ATOM atom);
+
+} // namespace ngs::xdisplay
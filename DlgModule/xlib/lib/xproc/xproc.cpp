@@ -25,7 +25,10 @@
 */
 
 #include <algorithm>
+#include <iterator>
 #include <sstream>
+#include <thread>
+#include <atomic>
 
 #include <cstdlib>
 #include <cstddef>
@@ -33,6 +36,7 @@
 #include <cstring>
 #include <climits>
 #include <cstdio>
+#include <cerrno>
 
 #include "xproc.hpp"
 
@@ -42,6 +46,7 @@
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <sys/stat.h>
+#include <sys/resource.h>
 #include <fcntl.h>
 #endif
 
@@ -57,6 +62,7 @@
 #include <libproc.h>
 #elif (defined(__linux__) || defined(__ANDROID__))
 #include <dirent.h>
+#include <sys/syscall.h>
 #elif defined(__FreeBSD__)
 #include <sys/socket.h>
 #include <sys/sysctl.h>
@@ -99,16 +105,6 @@ namespace {
     #endif
   }
 
-  std::vector<std::string> string_split_by_first_equals_sign(std::string str) {
-    std::size_t pos = 0;
-    std::vector<std::string> vec;
-    if ((pos = str.find_first_of("=")) != std::string::npos) {
-      vec.push_back(str.substr(0, pos));
-      vec.push_back(str.substr(pos + 1));
-    }
-    return vec;
-  }
-
   #if defined(_WIN32)
   enum MEMTYP {
     MEMCMD,
@@ -316,10 +312,91 @@ namespace {
   }
   #endif
 
+  #if (defined(__linux__) || defined(__ANDROID__))
+  // read a whole /proc file with plain read() calls into a reusable buffer.
+  // procfs reports a size of zero for these, so grow until a short read.
+  bool proc_file_read(const char *path, std::vector<char> &buffer) {
+    buffer.clear();
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) return false;
+    std::size_t length = 0;
+    if (buffer.capacity() < 4096) buffer.reserve(4096);
+    while (true) {
+      buffer.resize(buffer.capacity());
+      ssize_t nread = read(fd, buffer.data() + length, buffer.size() - length);
+      if (nread < 0 && errno == EINTR) continue;
+      if (nread <= 0) break;
+      length += (std::size_t)nread;
+      if (length == buffer.size()) buffer.reserve(buffer.size() * 2);
+    }
+    close(fd);
+    buffer.resize(length);
+    return true;
+  }
+  #endif
+
+  // split nul-separated entries into views, keeping empty ones; a final entry
+  // without a terminator gets one so every view stays a valid c string.
+  void nul_separated_views(std::vector<char> &buffer, std::vector<std::string_view> &vec) {
+    vec.clear();
+    if (!buffer.empty() && buffer.back() != '\0')
+      buffer.push_back('\0');
+    std::size_t begin = 0;
+    for (std::size_t i = 0; i < buffer.size(); i++) {
+      if (buffer[i] == '\0') {
+        vec.emplace_back(buffer.data() + begin, i - begin);
+        begin = i + 1;
+      }
+    }
+  }
+
+  #if !(defined(__linux__) || defined(__ANDROID__))
+  void nul_separated_from_strings(const std::vector<std::string> &strings, std::vector<char> &buffer, std::vector<std::string_view> &vec) {
+    buffer.clear();
+    for (const std::string &str : strings)
+      buffer.insert(buffer.end(), str.c_str(), str.c_str() + str.length() + 1);
+    nul_separated_views(buffer, vec);
+  }
+  #endif
+
   #if defined(__DragonFly__) || defined(__NetBSD__) || defined(__OpenBSD__) || defined(__sun)
   kvm_t *kd = nullptr;
   #endif
 
+  std::atomic<int> scan_thread_count(1);
+
+  // call fn(i) for every i below count on up to scan_thread_count threads. the
+  // workers claim small chunks from one shared counter, so whoever lands on cheap
+  // pids just claims more; fn stores its result by index to keep the order fixed.
+  // only linux reads are known to be safe to run concurrently, the kvm and
+  // procstat paths share global state, so everywhere else this stays serial.
+  template<typename F> void scan_parallel(std::size_t count, F fn) {
+    const std::size_t chunk = 32;
+    std::size_t threads = 1;
+    #if (defined(__linux__) || defined(__ANDROID__))
+    threads = (std::size_t)scan_thread_count.load();
+    #endif
+    if (threads > (count + chunk - 1) / chunk) threads = (count + chunk - 1) / chunk;
+    if (threads <= 1) {
+      for (std::size_t i = 0; i < count; i++) fn(i);
+      return;
+    }
+    std::atomic<std::size_t> next(0);
+    auto worker = [&]() {
+      std::size_t begin = 0;
+      while ((begin = next.fetch_add(chunk)) < count) {
+        std::size_t end = std::min(begin + chunk, count);
+        for (std::size_t i = begin; i < end; i++) fn(i);
+      }
+    };
+    std::vector<std::thread> pool;
+    for (std::size_t i = 1; i < threads; i++)
+      pool.emplace_back(worker);
+    worker();
+    for (std::thread &thread : pool)
+      thread.join();
+  }
+
 } // anonymous namespace
 
 namespace ngs::xproc {
@@ -423,10 +500,36 @@ namespace ngs::xproc {
     return vec;
   }
 
+  void proc_scan_set_thread_count(int count) {
+    scan_thread_count = (count < 1) ? 1 : count;
+  }
+
+  int proc_scan_get_thread_count() {
+    return scan_thread_count;
+  }
+
   bool proc_id_exists(PROCID proc_id) {
+    #if (defined(__linux__) || defined(__ANDROID__))
+    // proc_id_enum lists pid 0 plus every thread group in /proc. /proc/<tid> also
+    // resolves for non-leader threads, so check that the pid leads its group.
+    if (proc_id == 0) return true;
+    if (proc_id < 0) return false;
+    char buffer[1024];
+    sprintf(buffer, "/proc/%d/status", proc_id);
+    int fd = open(buffer, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) return false;
+    ssize_t size = read(fd, buffer, sizeof(buffer) - 1);
+    close(fd);
+    if (size <= 0) return false;
+    buffer[size] = '\0';
+    const char *tgid = strstr(buffer, "\nTgid:");
+    if (!tgid) return false;
+    return ((PROCID)strtoul(tgid + 6, nullptr, 10) == proc_id);
+    #else
     std::vector<PROCID> vec = proc_id_enum();
     auto itr = std::find(vec.begin(), vec.end(), proc_id);
     return (itr != vec.end());
+    #endif
   }
 
   bool proc_id_suspend(PROCID proc_id) {
@@ -508,19 +611,13 @@ namespace ngs::xproc {
     sprintf(buffer, "/proc/%d/stat", proc_id);
     FILE *stat = fopen(buffer, "r");
     if (stat) {
-      std::size_t size = fread(buffer, sizeof(char), sizeof(buffer), stat);
-      if (size > 0) {
-        char *token = nullptr;
-        if ((token = strtok(buffer, " "))) {
-          if ((token = strtok(nullptr, " "))) {
-            if ((token = strtok(nullptr, " "))) {
-              if ((token = strtok(nullptr, " "))) {
-                PROCID parent_proc_id = (PROCID)strtoul(token, nullptr, 10);
-                vec.push_back(parent_proc_id);
-              }
-            }
-          }
-        }
+      std::size_t size = fread(buffer, sizeof(char), sizeof(buffer) - 1, stat);
+      buffer[size] = '\0';
+      // the command name in parentheses may itself contain spaces.
+      const char *fields = strrchr(buffer, ')');
+      int parent_proc_id = 0;
+      if (fields && sscanf(fields + 1, " %*c %d", &parent_proc_id) == 1) {
+        vec.push_back((PROCID)parent_proc_id);
       }
       fclose(stat);
     }
@@ -609,11 +706,13 @@ namespace ngs::xproc {
     }
     #elif (defined(__linux__) || defined(__ANDROID__))
     std::vector<PROCID> proc_id = proc_id_enum();
-    for (std::size_t i = 0; i < proc_id.size(); i++) {
+    std::vector<char> match(proc_id.size());
+    scan_parallel(proc_id.size(), [&](std::size_t i) {
       std::vector<PROCID> ppid = parent_proc_id_from_proc_id(proc_id[i]);
-      if (!ppid.empty() && ppid[0] == parent_proc_id) {
-        vec.push_back(proc_id[i]);
-      }
+      match[i] = (!ppid.empty() && ppid[0] == parent_proc_id);
+    });
+    for (std::size_t i = 0; i < proc_id.size(); i++) {
+      if (match[i]) vec.push_back(proc_id[i]);
     }
     #elif defined(__FreeBSD__)
     int cntp = 0; 
@@ -711,10 +810,12 @@ namespace ngs::xproc {
     };
     std::vector<PROCID> vec;
     std::vector<PROCID> proc_id = proc_id_enum();
+    std::vector<char> match(proc_id.size());
+    scan_parallel(proc_id.size(), [&](std::size_t i) {
+      match[i] = fnamecmp(exe, exe_from_proc_id(proc_id[i]));
+    });
     for (std::size_t i = 0; i < proc_id.size(); i++) {
-      if (fnamecmp(exe, exe_from_proc_id(proc_id[i]))) {
-        vec.push_back(proc_id[i]);
-      }
+      if (match[i]) vec.push_back(proc_id[i]);
     }
     return vec;
   }
@@ -726,10 +827,12 @@ namespace ngs::xproc {
     };
     std::vector<PROCID> vec;
     std::vector<PROCID> proc_id = proc_id_enum();
+    std::vector<char> match(proc_id.size());
+    scan_parallel(proc_id.size(), [&](std::size_t i) {
+      match[i] = fnamecmp(cwd, cwd_from_proc_id(proc_id[i]));
+    });
     for (std::size_t i = 0; i < proc_id.size(); i++) {
-      if (fnamecmp(cwd, cwd_from_proc_id(proc_id[i]))) {
-        vec.push_back(proc_id[i]);
-      }
+      if (match[i]) vec.push_back(proc_id[i]);
     }
     return vec;
   }
@@ -1026,18 +1129,10 @@ namespace ngs::xproc {
     #elif (defined(__APPLE__) && defined(__MACH__))
     vec = cmd_env_from_proc_id(proc_id, MEMCMD);
     #elif (defined(__linux__) || defined(__ANDROID__))
-    FILE *file = fopen(("/proc/" + std::to_string(proc_id) + "/cmdline").c_str(), "rb");
-    if (file) {
-      char *cmd = nullptr;
-      std::size_t size = 0;
-      while (getdelim(&cmd, &size, 0, file) != -1) {
-        vec.push_back(cmd);
-      }
-      while (!vec.empty() && vec.back().empty())
-        vec.pop_back();
-      if (cmd) free(cmd);
-      fclose(file);
-    }
+    std::vector<char> buffer;
+    std::vector<std::string_view> views;
+    cmdline_from_proc_id(proc_id, buffer, views);
+    vec.assign(views.begin(), views.end());
     #elif defined(__FreeBSD__)
     unsigned cntp = 0;
     procstat *proc_stat = procstat_open_sysctl();
@@ -1138,22 +1233,10 @@ namespace ngs::xproc {
     #elif (defined(__APPLE__) && defined(__MACH__))
     vec = cmd_env_from_proc_id(proc_id, MEMENV);
     #elif (defined(__linux__) || defined(__ANDROID__))
-    FILE *file = fopen(("/proc/" + std::to_string(proc_id) + "/environ").c_str(), "rb");
-    if (file) {
-      char *env = nullptr;
-      std::size_t size = 0;
-      while (getdelim(&env, &size, 0, file) != -1) {
-        vec.push_back(env);
-      }
-      struct is_empty {
-        bool operator()(const std::string &s) {
-          return s.empty();
-        }
-      };
-      vec.erase(std::remove_if(vec.begin(), vec.end(), is_empty()), vec.end());
-      if (env) free(env);
-      fclose(file);
-    }
+    std::vector<char> buffer;
+    std::vector<std::string_view> views;
+    environ_from_proc_id(proc_id, buffer, views);
+    vec.assign(views.begin(), views.end());
     #elif defined(__FreeBSD__)
     unsigned cntp = 0;
     procstat *proc_stat = procstat_open_sysctl();
@@ -1236,48 +1319,328 @@ namespace ngs::xproc {
     return vec;
   }
 
+  void cmdline_from_proc_id(PROCID proc_id, std::vector<char> &buffer, std::vector<std::string_view> &vec) {
+    #if (defined(__linux__) || defined(__ANDROID__))
+    char path[64];
+    sprintf(path, "/proc/%d/cmdline", proc_id);
+    proc_file_read(path, buffer);
+    nul_separated_views(buffer, vec);
+    while (!vec.empty() && vec.back().empty())
+      vec.pop_back();
+    #else
+    nul_separated_from_strings(cmdline_from_proc_id(proc_id), buffer, vec);
+    #endif
+  }
+
+  void environ_from_proc_id(PROCID proc_id, std::vector<char> &buffer, std::vector<std::string_view> &vec) {
+    #if (defined(__linux__) || defined(__ANDROID__))
+    char path[64];
+    sprintf(path, "/proc/%d/environ", proc_id);
+    proc_file_read(path, buffer);
+    nul_separated_views(buffer, vec);
+    vec.erase(std::remove_if(vec.begin(), vec.end(), [](std::string_view view) {
+      return view.empty();
+    }), vec.end());
+    #else
+    nul_separated_from_strings(environ_from_proc_id(proc_id), buffer, vec);
+    #endif
+  }
+
   std::string envvar_value_from_proc_id(PROCID proc_id, std::string name) {
-    std::string value;
-    std::vector<std::string> vec = environ_from_proc_id(proc_id);
-    if (!vec.empty()) {
-      for (std::size_t i = 0; i < vec.size(); i++) {
-        message_pump();
-        std::vector<std::string> equalssplit = string_split_by_first_equals_sign(vec[i]);
-        if (equalssplit.size() == 2) {
-          #if defined(_WIN32)
-          std::transform(equalssplit[0].begin(), equalssplit[0].end(), equalssplit[0].begin(), ::toupper);
-          std::transform(name.begin(), name.end(), name.begin(), ::toupper);
-          #endif
-          if (equalssplit[0] == name) {
-            value = equalssplit[1];
-            break;
-          }
-        }
+    environ_view env(proc_id);
+    return std::string(env.value(name));
+  }
+
+  bool envvar_exists_from_proc_id(PROCID proc_id, std::string name) {
+    environ_view env(proc_id);
+    return env.exists(name);
+  }
+
+  environ_view::environ_view(PROCID proc_id) :
+  #if defined(_WIN32)
+  environ_view(proc_id, true) { }
+  #else
+  environ_view(proc_id, false) { }
+  #endif
+
+  environ_view::environ_view(PROCID proc_id, bool case_insensitive) :
+  index(0, name_hash { case_insensitive }, name_equal { case_insensitive }) {
+    environ_from_proc_id(proc_id, buffer, entries);
+    index.reserve(entries.size());
+    for (std::string_view entry : entries) {
+      message_pump();
+      std::size_t pos = entry.find('=');
+      if (pos == std::string_view::npos) continue;
+      index.emplace(entry.substr(0, pos), entry.substr(pos + 1));
+    }
+  }
+
+  std::size_t environ_view::name_hash::operator()(std::string_view name) const {
+    // fnv-1a, so folded and unfolded names can share one hash function.
+    std::size_t hash = (sizeof(std::size_t) == 8) ? (std::size_t)14695981039346656037ULL : (std::size_t)2166136261U;
+    std::size_t prime = (sizeof(std::size_t) == 8) ? (std::size_t)1099511628211ULL : (std::size_t)16777619U;
+    for (unsigned char c : name) {
+      hash ^= fold ? (unsigned char)toupper(c) : c;
+      hash *= prime;
+    }
+    return hash;
+  }
+
+  bool environ_view::name_equal::operator()(std::string_view name1, std::string_view name2) const {
+    if (name1.length() != name2.length()) return false;
+    if (!fold) return name1 == name2;
+    for (std::size_t i = 0; i < name1.length(); i++) {
+      if (toupper((unsigned char)name1[i]) != toupper((unsigned char)name2[i]))
+        return false;
+    }
+    return true;
+  }
+
+  bool environ_view::exists(std::string_view name) const {
+    return index.find(name) != index.end();
+  }
+
+  std::string_view environ_view::value(std::string_view name) const {
+    auto it = index.find(name);
+    if (it == index.end()) return std::string_view();
+    return it->second;
+  }
+
+  std::size_t environ_view::size() const {
+    return index.size();
+  }
+
+  proc_snapshot::proc_snapshot(std::chrono::milliseconds ttl) : time_to_live(ttl) {
+    refresh();
+  }
+
+  void proc_snapshot::refresh() {
+    entries.clear();
+    proc_id_index.clear();
+    children_index.clear();
+    exe_index.clear();
+    exe_dir_index.clear();
+    exe_name_index.clear();
+    cwd_index.clear();
+    paths_loaded = false;
+    #if defined(_WIN32)
+    HANDLE hp = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
+    if (hp) {
+      PROCESSENTRY32 pe;
+      pe.dwSize = sizeof(PROCESSENTRY32);
+      if (Process32First(hp, &pe)) {
+        do {
+          message_pump();
+          entries.push_back({ pe.th32ProcessID, { pe.th32ParentProcessID }, "", "" });
+        } while (Process32Next(hp, &pe));
       }
+      CloseHandle(hp);
     }
-    return value;
+    #else
+    std::vector<PROCID> proc_id = ngs::xproc::proc_id_enum();
+    entries.resize(proc_id.size());
+    scan_parallel(proc_id.size(), [&](std::size_t i) {
+      entries[i].proc_id = proc_id[i];
+      entries[i].parent_proc_id = ngs::xproc::parent_proc_id_from_proc_id(proc_id[i]);
+    });
+    #endif
+    for (std::size_t i = 0; i < entries.size(); i++) {
+      proc_id_index.emplace(entries[i].proc_id, i);
+      if (!entries[i].parent_proc_id.empty())
+        children_index[entries[i].parent_proc_id[0]].push_back(i);
+    }
+    taken = std::chrono::steady_clock::now();
   }
 
-  bool envvar_exists_from_proc_id(PROCID proc_id, std::string name) {
-    bool exists = false;
-    std::vector<std::string> vec = environ_from_proc_id(proc_id);
-    if (!vec.empty()) {
-      for (std::size_t i = 0; i < vec.size(); i++) {
-        message_pump();
-        std::vector<std::string> equalssplit = string_split_by_first_equals_sign(vec[i]);
-        if (!equalssplit.empty()) {
-          #if defined(_WIN32)
-          std::transform(equalssplit[0].begin(), equalssplit[0].end(), equalssplit[0].begin(), ::toupper);
-          std::transform(name.begin(), name.end(), name.begin(), ::toupper);
-          #endif
-          if (equalssplit[0] == name) {
-            exists = true;
-            break;
+  void proc_snapshot::set_time_to_live(std::chrono::milliseconds ttl) {
+    time_to_live = ttl;
+  }
+
+  void proc_snapshot::refresh_if_stale() {
+    if (time_to_live.count() > 0 && std::chrono::steady_clock::now() - taken >= time_to_live)
+      refresh();
+  }
+
+  void proc_snapshot::load_paths() {
+    if (paths_loaded) return;
+    paths_loaded = true;
+    scan_parallel(entries.size(), [&](std::size_t i) {
+      entries[i].exe = ngs::xproc::exe_from_proc_id(entries[i].proc_id);
+      entries[i].cwd = ngs::xproc::cwd_from_proc_id(entries[i].proc_id);
+    });
+    for (std::size_t i = 0; i < entries.size(); i++) {
+      entry &e = entries[i];
+      #if defined(_WIN32)
+      std::size_t fp = e.exe.find_last_of("\\/");
+      #else
+      std::size_t fp = e.exe.find_last_of("/");
+      #endif
+      if (fp != std::string::npos) {
+        exe_index[e.exe].push_back(i);
+        exe_dir_index[e.exe.substr(0, fp + 1)].push_back(i);
+        exe_name_index[e.exe.substr(fp + 1)].push_back(i);
+      }
+      if (!e.cwd.empty())
+        cwd_index[e.cwd].push_back(i);
+    }
+  }
+
+  std::vector<PROCID> proc_snapshot::proc_id_from_positions(const positions &pos) const {
+    std::vector<PROCID> vec;
+    vec.reserve(pos.size());
+    for (std::size_t i : pos)
+      vec.push_back(entries[i].proc_id);
+    return vec;
+  }
+
+  std::vector<PROCID> proc_snapshot::proc_id_enum() {
+    refresh_if_stale();
+    std::vector<PROCID> vec;
+    vec.reserve(entries.size());
+    for (const entry &e : entries)
+      vec.push_back(e.proc_id);
+    return vec;
+  }
+
+  bool proc_snapshot::proc_id_exists(PROCID proc_id) {
+    refresh_if_stale();
+    return proc_id_index.find(proc_id) != proc_id_index.end();
+  }
+
+  std::vector<PROCID> proc_snapshot::parent_proc_id_from_proc_id(PROCID proc_id) {
+    refresh_if_stale();
+    auto it = proc_id_index.find(proc_id);
+    if (it == proc_id_index.end()) return std::vector<PROCID>();
+    return entries[it->second].parent_proc_id;
+  }
+
+  std::vector<PROCID> proc_snapshot::proc_id_from_parent_proc_id(PROCID parent_proc_id) {
+    refresh_if_stale();
+    auto it = children_index.find(parent_proc_id);
+    if (it == children_index.end()) return std::vector<PROCID>();
+    return proc_id_from_positions(it->second);
+  }
+
+  // same matching rules as the free proc_id_from_exe: an absolute path matches
+  // the executable itself or its directory, anything else matches the file name.
+  std::vector<PROCID> proc_snapshot::proc_id_from_exe(std::string exe) {
+    refresh_if_stale();
+    load_paths();
+    if (exe.empty()) return std::vector<PROCID>();
+    auto lookup = [](const std::unordered_map<std::string, positions> &index, const std::string &key) {
+      auto it = index.find(key);
+      return (it == index.end()) ? positions() : it->second;
+    };
+    #if defined(_WIN32)
+    bool abspath = (exe.length() >= 3 && exe[1] == ':' && (exe[2] == '\\' || exe[2] == '/'));
+    bool root = (abspath && exe.length() == 3);
+    #else
+    bool abspath = (exe[0] == '/');
+    bool root = (abspath && exe.length() == 1);
+    #endif
+    if (!abspath) return proc_id_from_positions(lookup(exe_name_index, exe));
+    if (root) return proc_id_from_positions(lookup(exe_dir_index, exe));
+    positions pos = lookup(exe_index, exe);
+    positions dir = lookup(exe_dir_index, exe + "/");
+    #if defined(_WIN32)
+    positions dir_backslash = lookup(exe_dir_index, exe + "\\");
+    dir.insert(dir.end(), dir_backslash.begin(), dir_backslash.end());
+    std::sort(dir.begin(), dir.end());
+    #endif
+    positions merged;
+    std::set_union(pos.begin(), pos.end(), dir.begin(), dir.end(), std::back_inserter(merged));
+    return proc_id_from_positions(merged);
+  }
+
+  std::vector<PROCID> proc_snapshot::proc_id_from_cwd(std::string cwd) {
+    refresh_if_stale();
+    load_paths();
+    auto it = cwd_index.find(cwd);
+    if (cwd.empty() || it == cwd_index.end()) return std::vector<PROCID>();
+    return proc_id_from_positions(it->second);
+  }
+
+  std::string proc_snapshot::exe_from_proc_id(PROCID proc_id) {
+    refresh_if_stale();
+    load_paths();
+    auto it = proc_id_index.find(proc_id);
+    if (it == proc_id_index.end()) return "";
+    return entries[it->second].exe;
+  }
+
+  std::string proc_snapshot::cwd_from_proc_id(PROCID proc_id) {
+    refresh_if_stale();
+    load_paths();
+    auto it = proc_id_index.find(proc_id);
+    if (it == proc_id_index.end()) return "";
+    return entries[it->second].cwd;
+  }
+
+  #if !defined(_WIN32)
+  // close every descriptor >= lowfd in a forked child. only async-signal-safe calls
+  // are used: close_range where the kernel has it, closefrom on the bsds and solaris,
+  // a raw getdents64 walk of /proc/self/fd on older linux, and as a last resort a
+  // loop bounded by RLIMIT_NOFILE rather than a hardcoded 4096.
+  void close_fds_from(int lowfd) {
+    #if defined(__linux__) && defined(SYS_close_range)
+    if (syscall(SYS_close_range, (unsigned)lowfd, ~0U, 0) == 0)
+      return;
+    #endif
+    #if defined(__FreeBSD__) || defined(__DragonFly__) || defined(__NetBSD__) || defined(__OpenBSD__) || defined(__sun)
+    closefrom(lowfd);
+    return;
+    #endif
+    #if defined(__linux__) && defined(SYS_getdents64)
+    int dirfd = open("/proc/self/fd", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirfd != -1) {
+      struct linux_dirent64 {
+        std::uint64_t d_ino;
+        std::int64_t d_off;
+        unsigned short d_reclen;
+        unsigned char d_type;
+        char d_name[1];
+      };
+      alignas(8) char buffer[4096];
+      long nread = 0;
+      while ((nread = syscall(SYS_getdents64, dirfd, buffer, sizeof(buffer))) > 0) {
+        bool closed = false;
+        for (long pos = 0; pos < nread;) {
+          linux_dirent64 *entry = (linux_dirent64 *)(buffer + pos);
+          pos += entry->d_reclen;
+          int fd = 0; const char *p = entry->d_name;
+          if (*p < '0' || *p > '9') continue;
+          for (; *p >= '0' && *p <= '9'; p++)
+            fd = fd * 10 + (*p - '0');
+          if (fd >= lowfd && fd != dirfd) {
+            close(fd);
+            closed = true;
           }
         }
+        // closing entries while reading the directory may shift its offsets.
+        if (closed) lseek(dirfd, 0, SEEK_SET);
       }
+      close(dirfd);
+      if (nread == 0) return;
     }
-    return exists;
+    #endif
+    struct rlimit limit;
+    rlim_t maxfd = 65536;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY)
+      maxfd = limit.rlim_cur;
+    for (rlim_t i = (rlim_t)lowfd; i < maxfd; i++)
+      close((int)i);
+  }
+
+  bool pipe_cloexec(int fd[2]) {
+    #if defined(__linux__) || defined(__FreeBSD__) || defined(__DragonFly__) || defined(__NetBSD__) || defined(__OpenBSD__)
+    return (pipe2(fd, O_CLOEXEC) != -1);
+    #else
+    if (pipe(fd) == -1) return false;
+    fcntl(fd[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fd[1], F_SETFD, FD_CLOEXEC);
+    return true;
+    #endif
   }
+  #endif
 
 } // namespace ngs::xproc
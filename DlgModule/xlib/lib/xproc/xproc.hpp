@@ -26,8 +26,11 @@
 
 #pragma once
 
+#include <unordered_map>
 #include <vector>
 #include <string>
+#include <string_view>
+#include <chrono>
 
 namespace ngs::xproc {
 
@@ -38,6 +41,10 @@ namespace ngs::xproc {
   #endif
 
   std::vector<PROCID> proc_id_enum();
+  // threads used by scans that read every process (proc_id_from_exe/cwd/parent
+  // and proc_snapshot). 1, the default, scans serially; only linux honours more.
+  void proc_scan_set_thread_count(int count);
+  int proc_scan_get_thread_count();
   bool proc_id_exists(PROCID proc_id);
   bool proc_id_suspend(PROCID proc_id);
   bool proc_id_resume(PROCID proc_id);
@@ -50,7 +57,92 @@ namespace ngs::xproc {
   std::string cwd_from_proc_id(PROCID proc_id);
   std::vector<std::string> cmdline_from_proc_id(PROCID proc_id);
   std::vector<std::string> environ_from_proc_id(PROCID proc_id);
+  // zero-copy variants: buffer receives the nul-separated entries and vec views
+  // into it, both are reused between calls so a scan over many processes keeps
+  // their capacity instead of allocating a string per entry. every view is
+  // followed by a nul byte in buffer, so view.data() is also a c string.
+  void cmdline_from_proc_id(PROCID proc_id, std::vector<char> &buffer, std::vector<std::string_view> &vec);
+  void environ_from_proc_id(PROCID proc_id, std::vector<char> &buffer, std::vector<std::string_view> &vec);
   std::string envvar_value_from_proc_id(PROCID proc_id, std::string name);
   bool envvar_exists_from_proc_id(PROCID proc_id, std::string name);
 
+  #if !defined(_WIN32)
+  // descriptor helpers for the spawning code in cproc and the xlib dialogs.
+  // close_fds_from closes every descriptor >= lowfd and is async-signal-safe,
+  // so it can run in a forked child. pipe_cloexec sets close-on-exec atomically
+  // where pipe2 exists, so a fork elsewhere in the host can't inherit the ends.
+  void close_fds_from(int lowfd);
+  bool pipe_cloexec(int fd[2]);
+  #endif
+
+  // a process environment parsed once and indexed by name. like the free
+  // functions the first definition of a name wins; names compare exactly or,
+  // with case_insensitive, after ascii upper-casing. the default is to ignore
+  // case on windows only, which is what envvar_value_from_proc_id does.
+  class environ_view {
+  public:
+    environ_view(PROCID proc_id);
+    environ_view(PROCID proc_id, bool case_insensitive);
+    environ_view(const environ_view &) = delete;
+    environ_view &operator=(const environ_view &) = delete;
+    bool exists(std::string_view name) const;
+    std::string_view value(std::string_view name) const;
+    std::size_t size() const;
+
+  private:
+    struct name_hash {
+      bool fold;
+      std::size_t operator()(std::string_view name) const;
+    };
+    struct name_equal {
+      bool fold;
+      bool operator()(std::string_view name1, std::string_view name2) const;
+    };
+    std::vector<char> buffer;
+    std::vector<std::string_view> entries;
+    std::unordered_map<std::string_view, std::string_view, name_hash, name_equal> index;
+  };
+
+  // point-in-time view of the process table for answering many queries at once.
+  // pids and parents are read when the snapshot is taken; exe and cwd are read
+  // for every process the first time either is queried. with a zero time to live
+  // the snapshot only changes on refresh(), otherwise queries retake it once it
+  // is older than the time to live. not safe to share between threads.
+  class proc_snapshot {
+  public:
+    proc_snapshot(std::chrono::milliseconds ttl = std::chrono::milliseconds(0));
+    void refresh();
+    void set_time_to_live(std::chrono::milliseconds ttl);
+    std::vector<PROCID> proc_id_enum();
+    bool proc_id_exists(PROCID proc_id);
+    std::vector<PROCID> parent_proc_id_from_proc_id(PROCID proc_id);
+    std::vector<PROCID> proc_id_from_parent_proc_id(PROCID parent_proc_id);
+    std::vector<PROCID> proc_id_from_exe(std::string exe);
+    std::vector<PROCID> proc_id_from_cwd(std::string cwd);
+    std::string exe_from_proc_id(PROCID proc_id);
+    std::string cwd_from_proc_id(PROCID proc_id);
+
+  private:
+    struct entry {
+      PROCID proc_id;
+      std::vector<PROCID> parent_proc_id;
+      std::string exe;
+      std::string cwd;
+    };
+    typedef std::vector<std::size_t> positions;
+    std::vector<entry> entries;
+    std::unordered_map<PROCID, std::size_t> proc_id_index;
+    std::unordered_map<PROCID, positions> children_index;
+    std::unordered_map<std::string, positions> exe_index;
+    std::unordered_map<std::string, positions> exe_dir_index;
+    std::unordered_map<std::string, positions> exe_name_index;
+    std::unordered_map<std::string, positions> cwd_index;
+    bool paths_loaded = false;
+    std::chrono::milliseconds time_to_live;
+    std::chrono::steady_clock::time_point taken;
+    void refresh_if_stale();
+    void load_paths();
+    std::vector<PROCID> proc_id_from_positions(const positions &pos) const;
+  };
+
 } // namespace ngs::xproc
@@ -673,6 +673,7 @@ typedef struct HuffmanTree {
   /* for reading only */
   unsigned char* table_len; /*length of symbol from lookup table, or max length if secondary lookup needed*/
   unsigned short* table_value; /*value of symbol from lookup table, or pointer to secondary table if needed*/
+  unsigned* table_fast; /*packed single lookup table for inflateHuffmanFast, see HuffmanTree_makeFastTable*/
 } HuffmanTree;
 
 static void HuffmanTree_init(HuffmanTree* tree) {
@@ -680,6 +681,7 @@ static void HuffmanTree_init(HuffmanTree* tree) {
   tree->lengths = 0;
   tree->table_len = 0;
   tree->table_value = 0;
+  tree->table_fast = 0;
 }
 
 static void HuffmanTree_cleanup(HuffmanTree* tree) {
@@ -687,6 +689,7 @@ static void HuffmanTree_cleanup(HuffmanTree* tree) {
   lodepng_free(tree->lengths);
   lodepng_free(tree->table_len);
   lodepng_free(tree->table_value);
+  lodepng_free(tree->table_fast);
 }
 
 /* amount of bits for first huffman table lookup (aka root bits), see HuffmanTree_makeTable and huffmanDecodeSymbol.*/
@@ -1108,6 +1111,71 @@ static unsigned huffmanDecodeSymbol(LodePNGBitReader* reader, const HuffmanTree*
     return codetree->table_value[index2];
   }
 }
+
+/*
+Fast table for inflateHuffmanFast: one lookup of FASTBITS bits gives the code
+length and what to do with the symbol, without the second table or the
+LENGTHBASE/DISTANCEBASE lookups. Entry layout: bits 0-4 bits to advance, bits 5-7
+kind, bits 8-11 extra bits, bits 16-31 the literal (two literals for a pair, first
+one in the low byte) or the base length/distance. Codes longer than FASTBITS and
+invalid symbols are FAST_SLOW, which makes the fast loop hand over to the normal
+one for that symbol.
+*/
+#define FASTBITS 11u
+#define FAST_SLOW 0u
+#define FAST_LITERAL 1u
+#define FAST_PAIR 2u
+#define FAST_BASE 3u
+#define FAST_END 4u
+/*remaining compressed bytes below which inflateHuffmanBlock doesn't use the fast tables*/
+#define FAST_MIN_INPUT 4096u
+
+static unsigned HuffmanTree_makeFastTable(HuffmanTree* tree, unsigned litlen) {
+  static const unsigned size = 1u << FASTBITS;
+  unsigned i;
+  tree->table_fast = (unsigned*)lodepng_malloc(size * sizeof(unsigned));
+  if(!tree->table_fast) return 83; /*alloc fail*/
+
+  for(i = 0; i != size; ++i) {
+    /*same lookup as huffmanDecodeSymbol, bits above FASTBITS read as 0, which is fine as long as the code fits*/
+    unsigned code = i & ((1u << FIRSTBITS) - 1u);
+    unsigned l = tree->table_len[code];
+    unsigned symbol = tree->table_value[code];
+    unsigned entry = FAST_SLOW << 5u;
+    if(l > FIRSTBITS) {
+      unsigned index2 = symbol + ((i >> FIRSTBITS) & ((1u << (l - FIRSTBITS)) - 1u));
+      l = tree->table_len[index2];
+      symbol = tree->table_value[index2];
+    }
+    if(l <= FASTBITS) {
+      if(!litlen) {
+        if(symbol <= 29) entry = l | (FAST_BASE << 5u) | (DISTANCEEXTRA[symbol] << 8u) | (DISTANCEBASE[symbol] << 16u);
+      } else if(symbol <= 255) {
+        entry = l | (FAST_LITERAL << 5u) | (symbol << 16u);
+      } else if(symbol == 256) {
+        entry = l | (FAST_END << 5u);
+      } else if(symbol <= LAST_LENGTH_CODE_INDEX) {
+        symbol -= FIRST_LENGTH_CODE_INDEX;
+        entry = l | (FAST_BASE << 5u) | (LENGTHEXTRA[symbol] << 8u) | (LENGTHBASE[symbol] << 16u);
+      }
+    }
+    tree->table_fast[i] = entry;
+  }
+
+  /*a literal whose following bits within FASTBITS hold a whole second literal becomes a pair. going down means
+  the entry at i >> l, which is lower, has not been turned into a pair yet*/
+  if(litlen) {
+    for(i = size; i-- != 0;) {
+      unsigned entry = tree->table_fast[i];
+      unsigned l = entry & 31u, next;
+      if(((entry >> 5u) & 7u) != FAST_LITERAL) continue;
+      next = tree->table_fast[i >> l];
+      if(((next >> 5u) & 7u) != FAST_LITERAL || l + (next & 31u) > FASTBITS) continue;
+      tree->table_fast[i] = (l + (next & 31u)) | (FAST_PAIR << 5u) | (entry & 0x00ff0000u) | ((next & 0x00ff0000u) << 8u);
+    }
+  }
+  return 0;
+}
 #endif /*LODEPNG_COMPILE_DECODER*/
 
 #ifdef LODEPNG_COMPILE_DECODER
@@ -1256,6 +1324,104 @@ static unsigned getTreeInflateDynamic(HuffmanTree* tree_ll, HuffmanTree* tree_d,
   return error;
 }
 
+/*little endian 8 byte read, compilers turn this into a single load*/
+static LODEPNG_INLINE unsigned long long lodepng_read64(const unsigned char* p) {
+  return (unsigned long long)p[0] | ((unsigned long long)p[1] << 8u) | ((unsigned long long)p[2] << 16u) |
+         ((unsigned long long)p[3] << 24u) | ((unsigned long long)p[4] << 32u) | ((unsigned long long)p[5] << 40u) |
+         ((unsigned long long)p[6] << 48u) | ((unsigned long long)p[7] << 56u);
+}
+
+static LODEPNG_INLINE void lodepng_copy8(unsigned char* dst, const unsigned char* src) {
+#ifdef __GNUC__
+  __builtin_memcpy(dst, src, 8);
+#else
+  lodepng_memcpy(dst, src, 8);
+#endif
+}
+
+/*
+Decodes symbols of a Huffman block for as long as at least 8 input bytes are left,
+reading 64 bits at a time so that a whole length/distance pair needs only one read.
+Leaves the reader at the first symbol it can't handle (end of input, a code longer
+than FASTBITS, or anything invalid) for the normal loop in inflateHuffmanBlock,
+which then gives the same output and errors as before. Returns 1 if it consumed the
+end code. Back-references are copied 8 bytes at a time, so out always has room for
+a maximum length match plus 8 bytes beyond *pos.
+*/
+static unsigned inflateHuffmanFast(ucvector* out, size_t* pos, LodePNGBitReader* reader,
+                                   const HuffmanTree* tree_ll, const HuffmanTree* tree_d) {
+  static const unsigned mask = (1u << FASTBITS) - 1u;
+  const unsigned char* data = reader->data;
+  size_t bp = reader->bp, p = *pos;
+  unsigned done = 0;
+
+  if(reader->size < 8) return 0;
+  while((bp >> 3u) <= reader->size - 8u) {
+    unsigned long long bits;
+    unsigned entry, used, kind;
+    size_t length, distance, n;
+    unsigned char* dst;
+    const unsigned char* src;
+
+    if(p + 258u + 8u > out->allocsize) {
+      /*ucvector_reserve grows by half, so this doesn't happen often*/
+      if(!ucvector_reserve(out, p + 258u + 8u)) break; /*the normal loop reports the alloc fail*/
+    }
+
+    bits = lodepng_read64(data + (bp >> 3u)) >> (bp & 7u); /*at least 57 valid bits*/
+    entry = tree_ll->table_fast[bits & mask];
+    kind = (entry >> 5u) & 7u;
+    if(kind == FAST_LITERAL) {
+      out->data[p++] = (unsigned char)(entry >> 16u);
+      bp += entry & 31u;
+      continue;
+    } else if(kind == FAST_PAIR) {
+      out->data[p] = (unsigned char)(entry >> 16u);
+      out->data[p + 1] = (unsigned char)(entry >> 24u);
+      p += 2;
+      bp += entry & 31u;
+      continue;
+    } else if(kind == FAST_END) {
+      bp += entry & 31u;
+      done = 1;
+      break;
+    } else if(kind != FAST_BASE) {
+      break;
+    }
+
+    /*length/distance pair, at most FASTBITS + 5 + FASTBITS + 13 bits*/
+    used = entry & 31u;
+    length = (entry >> 16u) + (size_t)((bits >> used) & ((1u << ((entry >> 8u) & 15u)) - 1u));
+    used += (entry >> 8u) & 15u;
+    entry = tree_d->table_fast[(bits >> used) & mask];
+    if(((entry >> 5u) & 7u) != FAST_BASE) break;
+    used += entry & 31u;
+    distance = (entry >> 16u) + (size_t)((bits >> used) & ((1u << ((entry >> 8u) & 15u)) - 1u));
+    used += (entry >> 8u) & 15u;
+    if(distance > p) break; /*too long backward distance, error in the normal loop*/
+    bp += used;
+
+    dst = out->data + p;
+    src = dst - distance;
+    n = 0;
+    if(distance < 8) {
+      /*the match repeats with period distance, so once a multiple of distance of at least 8 is written,
+      copying from that far back gives the same bytes without overlapping a single 8 byte copy*/
+      size_t stride = distance;
+      while(stride < 8) stride += distance;
+      for(; n != stride && n != length; ++n) dst[n] = src[n];
+      src = dst - stride;
+    }
+    for(; n < length; n += 8) lodepng_copy8(dst + n, src + n);
+    p += length;
+  }
+
+  out->size = p;
+  *pos = p;
+  reader->bp = bp;
+  return done;
+}
+
 /*inflate a block with dynamic of fixed Huffman tree. btype must be 1 or 2.*/
 static unsigned inflateHuffmanBlock(ucvector* out, size_t* pos, LodePNGBitReader* reader,
                                     unsigned btype) {
@@ -1269,9 +1435,16 @@ static unsigned inflateHuffmanBlock(ucvector* out, size_t* pos, LodePNGBitReader
   if(btype == 1) getTreeInflateFixed(&tree_ll, &tree_d);
   else /*if(btype == 2)*/ error = getTreeInflateDynamic(&tree_ll, &tree_d, reader);
 
+  /*building the fast tables costs about as much as decoding a few KB, not worth it for small images*/
+  if(!error && reader->size - (reader->bp >> 3u) >= FAST_MIN_INPUT) {
+    error = HuffmanTree_makeFastTable(&tree_ll, 1);
+    if(!error) error = HuffmanTree_makeFastTable(&tree_d, 0);
+  }
+
   while(!error) /*decode all symbols until end reached, breaks at end code*/ {
     /*code_ll is literal, length or end code*/
     unsigned code_ll;
+    if(tree_d.table_fast && inflateHuffmanFast(out, pos, reader, &tree_ll, &tree_d)) break;
     ensureBits25(reader, 20); /* up to 15 for the huffman symbol, up to 5 for the length extra bits */
     code_ll = huffmanDecodeSymbol(reader, &tree_ll);
     if(code_ll <= 255) /*literal symbol*/ {
@@ -4005,6 +4178,241 @@ unsigned lodepng_inspect(unsigned* w, unsigned* h, LodePNGState* state,
   return state->error;
 }
 
+/*
+SIMD versions of the Up filter, and of Sub, Average and Paeth for 3 and 4 byte
+pixels (RGB, RGBA, 16-bit grey+alpha), which are what nearly every large image
+uses. Sub, Average and Paeth depend on the previous pixel so they still go pixel
+by pixel, but all channels of a pixel are done at once. The results are byte
+identical to the scalar code in unfilterScanline, which handles everything else.
+x86 picks SSE2 or SSSE3 at runtime, ARM uses NEON when the compiler targets it.
+Define LODEPNG_NO_COMPILE_SIMD to use only the scalar code.
+*/
+#if !defined(LODEPNG_NO_COMPILE_SIMD) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define LODEPNG_UNFILTER_X86
+#include <immintrin.h>
+#elif !defined(LODEPNG_NO_COMPILE_SIMD) && defined(__GNUC__) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#define LODEPNG_UNFILTER_NEON
+#include <arm_neon.h>
+#endif
+
+#if defined(LODEPNG_UNFILTER_X86) || defined(LODEPNG_UNFILTER_NEON)
+/*one pixel of bytewidth 3 or 4 in the low lanes of a register. every pixel is
+loaded before the recon pixel at the same index is stored, which keeps the in
+place use (recon in front of scanline in the same buffer) working. remaining is
+the number of bytes left in the row from p.*/
+static LODEPNG_INLINE unsigned lodepng_load_pixel(const unsigned char* p, size_t bytewidth, size_t remaining) {
+  unsigned v = 0;
+  /*fixed sizes so these become plain loads instead of a byte loop. a 3 byte
+  pixel is read 4 bytes wide while the row has a byte to spare, since a 3 byte
+  copy is two loads; the extra byte sits in a lane nothing reads or stores.*/
+  if(bytewidth == 4 || remaining >= 4) __builtin_memcpy(&v, p, 4);
+  else __builtin_memcpy(&v, p, 3);
+  return v;
+}
+
+static LODEPNG_INLINE void lodepng_store_pixel(unsigned char* p, unsigned v, size_t bytewidth) {
+  if(bytewidth == 4) __builtin_memcpy(p, &v, 4);
+  else __builtin_memcpy(p, &v, 3);
+}
+#endif
+
+#ifdef LODEPNG_UNFILTER_X86
+__attribute__((target("sse2")))
+static void unfilterUp_sse2(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon,
+                            size_t length) {
+  size_t i = 0;
+  for(; i + 16 <= length; i += 16) {
+    __m128i s = _mm_loadu_si128((const __m128i*)(scanline + i));
+    __m128i p = _mm_loadu_si128((const __m128i*)(precon + i));
+    _mm_storeu_si128((__m128i*)(recon + i), _mm_add_epi8(s, p));
+  }
+  for(; i != length; ++i) recon[i] = scanline[i] + precon[i];
+}
+
+__attribute__((target("sse2")))
+static void unfilterSub_sse2(unsigned char* recon, const unsigned char* scanline, size_t bytewidth, size_t length) {
+  size_t i = 0;
+  __m128i a = _mm_setzero_si128();
+  for(; i + bytewidth <= length; i += bytewidth) {
+    a = _mm_add_epi8(a, _mm_cvtsi32_si128((int)lodepng_load_pixel(&scanline[i], bytewidth, length - i)));
+    lodepng_store_pixel(&recon[i], (unsigned)_mm_cvtsi128_si32(a), bytewidth);
+  }
+  for(; i < length; ++i) recon[i] = scanline[i] + recon[i - bytewidth];
+}
+
+/*(a + b) >> 1 per byte: pavgb rounds up, so take the carry bit back off. precon may be null.*/
+__attribute__((target("sse2")))
+static void unfilterAverage_sse2(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon,
+                                 size_t bytewidth, size_t length) {
+  size_t i = 0;
+  const __m128i one = _mm_set1_epi8(1);
+  __m128i a = _mm_setzero_si128(), b = _mm_setzero_si128();
+  for(; i + bytewidth <= length; i += bytewidth) {
+    __m128i x = _mm_cvtsi32_si128((int)lodepng_load_pixel(&scanline[i], bytewidth, length - i));
+    if(precon) b = _mm_cvtsi32_si128((int)lodepng_load_pixel(&precon[i], bytewidth, length - i));
+    __m128i average = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), one));
+    a = _mm_add_epi8(x, average);
+    lodepng_store_pixel(&recon[i], (unsigned)_mm_cvtsi128_si32(a), bytewidth);
+  }
+  for(; i < length; ++i) recon[i] = scanline[i] + ((recon[i - bytewidth] + (precon ? precon[i] : 0)) >> 1u);
+}
+
+/*
+paethPredictor on 16-bit lanes: with p = b - c and q = a - c, pa = |p|, pb = |q| and
+pc = |p + q|. b wins over a only when pb < pa, and c wins only when pc is below both,
+the same priority as the scalar version. the first pixel uses a = c = 0, for which
+the predictor gives b, just like the scalar loop. precon must not be null.
+*/
+#define LODEPNG_PAETH_X86(ABS16)\
+  size_t i = 0;\
+  const __m128i zero = _mm_setzero_si128();\
+  __m128i a = zero, c = zero;\
+  for(; i + bytewidth <= length; i += bytewidth) {\
+    __m128i x = _mm_cvtsi32_si128((int)lodepng_load_pixel(&scanline[i], bytewidth, length - i));\
+    __m128i b = _mm_unpacklo_epi8(_mm_cvtsi32_si128((int)lodepng_load_pixel(&precon[i], bytewidth, length - i)), zero);\
+    __m128i p = _mm_sub_epi16(b, c), q = _mm_sub_epi16(a, c);\
+    __m128i pa = ABS16(p), pb = ABS16(q), pc = ABS16(_mm_add_epi16(p, q));\
+    __m128i use_b = _mm_cmplt_epi16(pb, pa);\
+    __m128i predictor = _mm_or_si128(_mm_and_si128(use_b, b), _mm_andnot_si128(use_b, a));\
+    __m128i use_c = _mm_cmplt_epi16(pc, _mm_min_epi16(pa, pb));\
+    predictor = _mm_or_si128(_mm_and_si128(use_c, c), _mm_andnot_si128(use_c, predictor));\
+    __m128i result = _mm_add_epi8(x, _mm_packus_epi16(predictor, predictor));\
+    lodepng_store_pixel(&recon[i], (unsigned)_mm_cvtsi128_si32(result), bytewidth);\
+    a = _mm_unpacklo_epi8(result, zero);\
+    c = b;\
+  }\
+  for(; i < length; ++i) {\
+    recon[i] = (scanline[i] + paethPredictor(recon[i - bytewidth], precon[i], precon[i - bytewidth]));\
+  }
+
+#define LODEPNG_ABS16_SSE2(x) _mm_max_epi16((x), _mm_sub_epi16(zero, (x)))
+#define LODEPNG_ABS16_SSSE3(x) _mm_abs_epi16(x)
+
+__attribute__((target("sse2")))
+static void unfilterPaeth_sse2(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon,
+                               size_t bytewidth, size_t length) {
+  LODEPNG_PAETH_X86(LODEPNG_ABS16_SSE2)
+}
+
+__attribute__((target("ssse3")))
+static void unfilterPaeth_ssse3(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon,
+                                size_t bytewidth, size_t length) {
+  LODEPNG_PAETH_X86(LODEPNG_ABS16_SSSE3)
+}
+
+#undef LODEPNG_ABS16_SSSE3
+#undef LODEPNG_ABS16_SSE2
+#undef LODEPNG_PAETH_X86
+
+/*returns 1 if the scanline was handled, 0 to fall back to the scalar code*/
+static int unfilterScanlineSIMD(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon,
+                                size_t bytewidth, unsigned char filterType, size_t length) {
+  /*__builtin_cpu_supports only reads flags filled in at startup, so no caching*/
+  if(!__builtin_cpu_supports("sse2")) return 0;
+  if(filterType == 2) {
+    if(!precon) return 0;
+    unfilterUp_sse2(recon, scanline, precon, length);
+    return 1;
+  }
+  if(bytewidth != 3 && bytewidth != 4) return 0;
+  switch(filterType) {
+    case 1: unfilterSub_sse2(recon, scanline, bytewidth, length); return 1;
+    case 3: unfilterAverage_sse2(recon, scanline, precon, bytewidth, length); return 1;
+    case 4:
+      if(!precon) return 0;
+      if(__builtin_cpu_supports("ssse3")) unfilterPaeth_ssse3(recon, scanline, precon, bytewidth, length);
+      else unfilterPaeth_sse2(recon, scanline, precon, bytewidth, length);
+      return 1;
+    default: return 0;
+  }
+}
+#endif /*LODEPNG_UNFILTER_X86*/
+
+#ifdef LODEPNG_UNFILTER_NEON
+static LODEPNG_INLINE uint8x8_t lodepng_neon_pixel(const unsigned char* p, size_t bytewidth, size_t remaining) {
+  return vreinterpret_u8_u32(vdup_n_u32(lodepng_load_pixel(p, bytewidth, remaining)));
+}
+
+static LODEPNG_INLINE void lodepng_neon_store(unsigned char* p, uint8x8_t v, size_t bytewidth) {
+  lodepng_store_pixel(p, vget_lane_u32(vreinterpret_u32_u8(v), 0), bytewidth);
+}
+
+static void unfilterUp_neon(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon,
+                            size_t length) {
+  size_t i = 0;
+  for(; i + 16 <= length; i += 16) {
+    vst1q_u8(recon + i, vaddq_u8(vld1q_u8(scanline + i), vld1q_u8(precon + i)));
+  }
+  for(; i != length; ++i) recon[i] = scanline[i] + precon[i];
+}
+
+static void unfilterSub_neon(unsigned char* recon, const unsigned char* scanline, size_t bytewidth, size_t length) {
+  size_t i = 0;
+  uint8x8_t a = vdup_n_u8(0);
+  for(; i + bytewidth <= length; i += bytewidth) {
+    a = vadd_u8(a, lodepng_neon_pixel(&scanline[i], bytewidth, length - i));
+    lodepng_neon_store(&recon[i], a, bytewidth);
+  }
+  for(; i < length; ++i) recon[i] = scanline[i] + recon[i - bytewidth];
+}
+
+/*vhadd is the truncating (a + b) >> 1 the filter wants. precon may be null.*/
+static void unfilterAverage_neon(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon,
+                                 size_t bytewidth, size_t length) {
+  size_t i = 0;
+  uint8x8_t a = vdup_n_u8(0), b = vdup_n_u8(0);
+  for(; i + bytewidth <= length; i += bytewidth) {
+    uint8x8_t x = lodepng_neon_pixel(&scanline[i], bytewidth, length - i);
+    if(precon) b = lodepng_neon_pixel(&precon[i], bytewidth, length - i);
+    a = vadd_u8(x, vhadd_u8(a, b));
+    lodepng_neon_store(&recon[i], a, bytewidth);
+  }
+  for(; i < length; ++i) recon[i] = scanline[i] + ((recon[i - bytewidth] + (precon ? precon[i] : 0)) >> 1u);
+}
+
+/*same lane-wise predictor as the x86 version. precon must not be null.*/
+static void unfilterPaeth_neon(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon,
+                               size_t bytewidth, size_t length) {
+  size_t i = 0;
+  int16x8_t a = vdupq_n_s16(0), c = vdupq_n_s16(0);
+  for(; i + bytewidth <= length; i += bytewidth) {
+    uint8x8_t x = lodepng_neon_pixel(&scanline[i], bytewidth, length - i);
+    int16x8_t b = vreinterpretq_s16_u16(vmovl_u8(lodepng_neon_pixel(&precon[i], bytewidth, length - i)));
+    int16x8_t p = vsubq_s16(b, c), q = vsubq_s16(a, c);
+    int16x8_t pa = vabsq_s16(p), pb = vabsq_s16(q), pc = vabsq_s16(vaddq_s16(p, q));
+    int16x8_t predictor = vbslq_s16(vcltq_s16(pb, pa), b, a);
+    predictor = vbslq_s16(vcltq_s16(pc, vminq_s16(pa, pb)), c, predictor);
+    uint8x8_t result = vadd_u8(x, vmovn_u16(vreinterpretq_u16_s16(predictor)));
+    lodepng_neon_store(&recon[i], result, bytewidth);
+    a = vreinterpretq_s16_u16(vmovl_u8(result));
+    c = b;
+  }
+  for(; i < length; ++i) {
+    recon[i] = (scanline[i] + paethPredictor(recon[i - bytewidth], precon[i], precon[i - bytewidth]));
+  }
+}
+
+/*returns 1 if the scanline was handled, 0 to fall back to the scalar code*/
+static int unfilterScanlineSIMD(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon,
+                                size_t bytewidth, unsigned char filterType, size_t length) {
+  if(filterType == 2) {
+    if(!precon) return 0;
+    unfilterUp_neon(recon, scanline, precon, length);
+    return 1;
+  }
+  if(bytewidth != 3 && bytewidth != 4) return 0;
+  switch(filterType) {
+    case 1: unfilterSub_neon(recon, scanline, bytewidth, length); return 1;
+    case 3: unfilterAverage_neon(recon, scanline, precon, bytewidth, length); return 1;
+    case 4:
+      if(!precon) return 0;
+      unfilterPaeth_neon(recon, scanline, precon, bytewidth, length);
+      return 1;
+    default: return 0;
+  }
+}
+#endif /*LODEPNG_UNFILTER_NEON*/
+
 static unsigned unfilterScanline(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon,
                                  size_t bytewidth, unsigned char filterType, size_t length) {
   /*
@@ -4017,6 +4425,9 @@ static unsigned unfilterScanline(unsigned char* recon, const unsigned char* scan
   */
 
   size_t i;
+#if defined(LODEPNG_UNFILTER_X86) || defined(LODEPNG_UNFILTER_NEON)
+  if(unfilterScanlineSIMD(recon, scanline, precon, bytewidth, filterType, length)) return 0;
+#endif
   switch(filterType) {
     case 0:
       for(i = 0; i != length; ++i) recon[i] = scanline[i];
@@ -0,0 +1,100 @@
+/*
+Stress test for cproc's executed process registry.
+
+Several threads each launch short-lived children with process_execute_async,
+all at the same time. Every child echoes a number unique to it. Each thread
+waits for its children to complete, checks their output, frees both streams
+and checks that completion is still reported for the freed handle. Any
+mismatch is printed and makes the exit status nonzero.
+
+From the repository root:
+
+  g++ -O2 -std=c++17 -DPROCESS_GUIWINDOW_IMPL -IDlgModule/xlib DlgModule/xlib/test/cproc_execute_stress.cpp \
+    DlgModule/xlib/lib/cproc/cproc.cpp DlgModule/xlib/lib/xproc/xproc.cpp DlgModule/xlib/lib/xdisplay/xdisplay.cpp \
+    -lX11 -lpthread -o cproc_execute_stress
+  ./cproc_execute_stress 16 250
+
+Building with -fsanitize=thread as well checks the registry for data races.
+
+Usage: cproc_execute_stress [threads [children per thread]], 16 and 250 by
+default.
+*/
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "lib/cproc/cproc.hpp"
+
+namespace {
+
+std::atomic<int> failures(0);
+
+void fail(int thread, int child, const char *what, const std::string &detail) {
+  failures++;
+  fprintf(stderr, "thread %d child %d: %s %s\n", thread, child, what, detail.c_str());
+}
+
+void launch(int thread, int children) {
+  std::vector<CPROCID> handles(children);
+  for (int i = 0; i < children; i++) {
+    std::string command = "echo " + std::to_string(thread * 1000000 + i);
+    handles[i] = ngs::cproc::process_execute_async(command.c_str());
+    if (!handles[i]) fail(thread, i, "did not start", command);
+  }
+  for (int i = 0; i < children; i++) {
+    CPROCID handle = handles[i];
+    if (!handle) continue;
+    while (!ngs::cproc::completion_status_from_executed_process(handle))
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    std::string expected = std::to_string(thread * 1000000 + i);
+    std::string output = ngs::cproc::executed_process_read_from_standard_output(handle);
+    while (!output.empty() && output.back() == '\n') output.pop_back();
+    if (output != expected) fail(thread, i, "read", "'" + output + "' instead of '" + expected + "'");
+    ngs::cproc::free_executed_process_standard_input(handle);
+    ngs::cproc::free_executed_process_standard_output(handle);
+    if (!ngs::cproc::completion_status_from_executed_process(handle))
+      fail(thread, i, "lost completion", "after both streams were freed");
+  }
+}
+
+int open_descriptors() {
+  int count = 0;
+  for (int fd = 0; fd < 4096; fd++) {
+    if (fcntl(fd, F_GETFD) != -1) count++;
+  }
+  return count;
+}
+
+} // anonymous namespace
+
+int main(int argc, char **argv) {
+  int threads = argc > 1 ? atoi(argv[1]) : 16;
+  int children = argc > 2 ? atoi(argv[2]) : 250;
+
+  // the first launch opens the executor's own wakeup pipe, which stays open.
+  launch(-1, 1);
+  int descriptors = open_descriptors();
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> launchers;
+  for (int t = 0; t < threads; t++) launchers.emplace_back(launch, t, children);
+  for (std::thread &launcher : launchers) launcher.join();
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  // every stream was freed, so nothing should be left open.
+  int leaked = open_descriptors() - descriptors;
+  if (leaked > 0) {
+    failures++;
+    fprintf(stderr, "%d descriptors left open\n", leaked);
+  }
+  printf("%d children on %d threads in %.2f s, %d failures\n", threads * children, threads, seconds, failures.load());
+  return failures ? 1 : 0;
+}
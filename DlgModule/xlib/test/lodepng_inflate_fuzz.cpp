@@ -0,0 +1,135 @@
+/*
+Fuzz comparison for lodepng_inflate.
+
+Each case generates data of one of several shapes (random, small alphabet,
+short repeats, text-like, RGBA-like), deflates it with zlib as a raw stream at
+a random level, strategy and memLevel, and then leaves it intact, flips a few
+bits or truncates it. The case is inflated with lodepng_inflate and one line is
+printed with the error code, the output size and a hash of the output. Intact
+streams must also give back the input; any that do not are reported on stderr
+and make the exit status nonzero.
+
+The cases only depend on the seed, so two builds of this program against two
+versions of lodepng.cpp must print identical lines. To check the table-driven
+fast path against the per-symbol decoder it was added to, from the repository
+root:
+
+  git show f09329a^:DlgModule/xlib/lodepng.cpp > lodepng_ref.cpp
+  g++ -O2 -IDlgModule/xlib DlgModule/xlib/test/lodepng_inflate_fuzz.cpp DlgModule/xlib/lodepng.cpp -lz -o fuzz_new
+  g++ -O2 -IDlgModule/xlib DlgModule/xlib/test/lodepng_inflate_fuzz.cpp lodepng_ref.cpp -lz -o fuzz_ref
+  ./fuzz_new 100000 > new.txt && ./fuzz_ref 100000 > ref.txt && cmp new.txt ref.txt
+
+Usage: lodepng_inflate_fuzz [cases [seed]], 20000 cases and seed 12345 by
+default. Adding -fsanitize=address,undefined to the first build is worthwhile.
+*/
+
+#include "lodepng.h"
+
+#include <zlib.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+
+typedef std::vector<unsigned char> bytes;
+
+bytes deflate_raw(const bytes& in, int level, int strategy, int mem_level) {
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  deflateInit2(&stream, level, Z_DEFLATED, -15, mem_level, strategy);
+  bytes out(deflateBound(&stream, in.size()) + 64);
+  stream.next_in = (Bytef*)in.data();
+  stream.avail_in = (uInt)in.size();
+  stream.next_out = out.data();
+  stream.avail_out = (uInt)out.size();
+  deflate(&stream, Z_FINISH);
+  out.resize(stream.total_out);
+  deflateEnd(&stream);
+  return out;
+}
+
+unsigned long long fnv1a(const unsigned char* data, size_t size) {
+  unsigned long long hash = 1469598103934665603ull;
+  for(size_t i = 0; i != size; ++i) hash = (hash ^ data[i]) * 1099511628211ull;
+  return hash;
+}
+
+/* every draw is its own statement, so the order is the same for every compiler */
+bytes generate(std::mt19937_64& rng, size_t size) {
+  bytes data(size);
+  unsigned shape = rng() % 5;
+  unsigned alphabet = 2 + rng() % 254;
+  for(size_t i = 0; i != size; ++i) {
+    if(shape == 0) {
+      data[i] = (unsigned char)rng();
+    } else if(shape == 1) {
+      data[i] = (unsigned char)(rng() % alphabet);
+    } else if(shape == 2) {
+      /* mostly copies of one of the last few bytes */
+      unsigned copy = rng() % 8;
+      unsigned span = 1 + rng() % 7;
+      unsigned back = rng() % span;
+      unsigned char fresh = (unsigned char)rng();
+      data[i] = (i >= 8 && copy) ? data[i - 1 - back] : fresh;
+    } else if(shape == 3) {
+      /* letters with frequent matches up to 300 bytes back */
+      bool copy = i > 300 && rng() % 16;
+      size_t back = rng() % 300;
+      unsigned char letter = (unsigned char)('a' + rng() % 26);
+      data[i] = copy ? data[i - 1 - back] : letter;
+    } else {
+      /* opaque pixels of a noisy gradient */
+      unsigned noise = rng() % 3;
+      data[i] = (i % 4 == 3) ? 255 : (unsigned char)((i / 4) * 7 + noise);
+    }
+  }
+  return data;
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+  static const int strategies[] = { Z_DEFAULT_STRATEGY, Z_FILTERED, Z_HUFFMAN_ONLY, Z_RLE, Z_FIXED };
+  int cases = argc > 1 ? atoi(argv[1]) : 20000;
+  std::mt19937_64 rng(argc > 2 ? strtoull(argv[2], 0, 10) : 12345);
+  LodePNGDecompressSettings settings = lodepng_default_decompress_settings;
+  int failures = 0;
+
+  for(int c = 0; c != cases; ++c) {
+    /* every tenth case is large enough for the fast path */
+    size_t size = rng() % (c % 10 == 0 ? 300000 : 5000);
+    bytes data = generate(rng, size);
+    int level = (int)(rng() % 10);
+    int strategy = strategies[rng() % 5];
+    int mem_level = (int)(1 + rng() % 9);
+    bytes stream = deflate_raw(data, level, strategy, mem_level);
+
+    unsigned damage = rng() % 3;
+    if(damage == 1 && !stream.empty()) {
+      unsigned flips = 1 + rng() % 4;
+      while(flips--) {
+        size_t at = rng() % stream.size();
+        unsigned bit = rng() % 8;
+        stream[at] ^= (unsigned char)(1u << bit);
+      }
+    } else if(damage == 2 && !stream.empty()) {
+      stream.resize(rng() % stream.size());
+    }
+
+    unsigned char* out = 0;
+    size_t outsize = 0;
+    unsigned error = lodepng_inflate(&out, &outsize, stream.data(), stream.size(), &settings);
+    if(damage == 0 && size != 0 && (error || outsize != size || memcmp(out, data.data(), size))) {
+      fprintf(stderr, "case %d: intact stream did not round trip (error %u)\n", c, error);
+      ++failures;
+    }
+    printf("%d %u %zu %llx\n", c, error, outsize, error ? 0ull : fnv1a(out, outsize));
+    free(out);
+  }
+
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,221 @@
+/*
+Round trip comparison for lodepng's scanline unfiltering.
+
+Each case generates an image of random size and content in one of RGB8, RGBA8,
+GA16, G8 or RGB16, interlaced or not, and encodes it with one of the filter
+strategies: each of the five filters alone, minsum, entropy, brute force, or
+predefined with a random filter per scanline. The cases cycle through every
+combination of color mode, interlacing and strategy. The PNG is decoded back to
+the same color mode, and one line is printed with the error code, the PNG size
+and hashes of the PNG and of the decoded pixels. Decoded pixels that differ
+from the input are reported on stderr and make the exit status nonzero.
+
+The cases only depend on the seed, so a build with the SIMD unfilters and one
+with LODEPNG_NO_COMPILE_SIMD must print identical lines. From the repository
+root:
+
+  g++ -O2 -IDlgModule/xlib DlgModule/xlib/test/lodepng_unfilter_compare.cpp DlgModule/xlib/lodepng.cpp -o unfilter_simd
+  g++ -O2 -DLODEPNG_NO_COMPILE_SIMD -IDlgModule/xlib DlgModule/xlib/test/lodepng_unfilter_compare.cpp \
+    DlgModule/xlib/lodepng.cpp -o unfilter_scalar
+  ./unfilter_simd 5000 > simd.txt && ./unfilter_scalar 5000 > scalar.txt && cmp simd.txt scalar.txt
+
+With --time, a large RGB8 and RGBA8 image is encoded with each of the five
+filters on every scanline, and the time to decode it is printed, so the two
+builds can be compared:
+
+  ./unfilter_simd --time 2048 && ./unfilter_scalar --time 2048
+
+Usage: lodepng_unfilter_compare [cases [seed]], 2000 cases and seed 12345 by
+default, or lodepng_unfilter_compare --time [size [iterations]], 2048 and 10
+by default. Adding -fsanitize=address,undefined to the first build is
+worthwhile.
+*/
+
+#include "lodepng.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+
+typedef std::vector<unsigned char> bytes;
+
+struct color_mode {
+  const char* name;
+  LodePNGColorType colortype;
+  unsigned bitdepth;
+  unsigned channels;
+};
+
+const color_mode modes[] = {
+  { "RGB8", LCT_RGB, 8, 3 },
+  { "RGBA8", LCT_RGBA, 8, 4 },
+  { "GA16", LCT_GREY_ALPHA, 16, 2 },
+  { "G8", LCT_GREY, 8, 1 },
+  { "RGB16", LCT_RGB, 16, 3 }
+};
+
+const LodePNGFilterStrategy strategies[] = {
+  LFS_ZERO, LFS_ONE, LFS_TWO, LFS_THREE, LFS_FOUR, LFS_MINSUM, LFS_ENTROPY, LFS_BRUTE_FORCE, LFS_PREDEFINED
+};
+
+const char* const strategy_names[] = {
+  "zero", "one", "two", "three", "four", "minsum", "entropy", "brute", "predefined"
+};
+
+const size_t mode_count = sizeof(modes) / sizeof(modes[0]);
+const size_t strategy_count = sizeof(strategies) / sizeof(strategies[0]);
+
+unsigned long long fnv1a(const unsigned char* data, size_t size) {
+  unsigned long long hash = 1469598103934665603ull;
+  for(size_t i = 0; i != size; ++i) hash = (hash ^ data[i]) * 1099511628211ull;
+  return hash;
+}
+
+/* every draw is its own statement, so the order is the same for every compiler */
+bytes generate(std::mt19937_64& rng, size_t size, size_t pixel) {
+  bytes data(size);
+  unsigned shape = rng() % 3;
+  for(size_t i = 0; i != size; ++i) {
+    if(shape == 0) {
+      data[i] = (unsigned char)rng();
+    } else if(shape == 1) {
+      /* a noisy gradient, which the predicting filters do well on */
+      unsigned noise = rng() % 5;
+      data[i] = (unsigned char)((i / pixel) * 3 + (i % pixel) * 40 + noise);
+    } else {
+      /* runs of repeated pixels */
+      unsigned repeat = rng() % 4;
+      unsigned char fresh = (unsigned char)rng();
+      data[i] = (i >= pixel && repeat) ? data[i - pixel] : fresh;
+    }
+  }
+  return data;
+}
+
+void configure(LodePNGState* state, const color_mode& mode, unsigned interlace, LodePNGFilterStrategy strategy,
+               const unsigned char* predefined) {
+  state->info_raw.colortype = mode.colortype;
+  state->info_raw.bitdepth = mode.bitdepth;
+  state->info_png.color.colortype = mode.colortype;
+  state->info_png.color.bitdepth = mode.bitdepth;
+  state->info_png.interlace_method = interlace;
+  state->encoder.auto_convert = 0;
+  state->encoder.filter_palette_zero = 0;
+  state->encoder.filter_strategy = strategy;
+  state->encoder.predefined_filters = predefined;
+}
+
+int compare(int cases, unsigned long long seed) {
+  std::mt19937_64 rng(seed);
+  int failures = 0;
+
+  for(int c = 0; c != cases; ++c) {
+    const color_mode& mode = modes[c % mode_count];
+    unsigned interlace = (unsigned)(c / mode_count % 2);
+    size_t s = c / (mode_count * 2) % strategy_count;
+    unsigned w = 1 + (unsigned)(rng() % 80);
+    unsigned h = 1 + (unsigned)(rng() % 40);
+    size_t pixel = mode.channels * mode.bitdepth / 8;
+    bytes image = generate(rng, (size_t)w * h * pixel, pixel);
+    bytes predefined(h);
+    for(unsigned y = 0; y != h; ++y) predefined[y] = (unsigned char)(rng() % 5);
+
+    LodePNGState state;
+    lodepng_state_init(&state);
+    configure(&state, mode, interlace, strategies[s], predefined.data());
+    unsigned char* png = 0;
+    size_t pngsize = 0;
+    unsigned error = lodepng_encode(&png, &pngsize, image.data(), w, h, &state);
+    lodepng_state_cleanup(&state);
+
+    unsigned char* out = 0;
+    unsigned ow = 0, oh = 0;
+    if(!error) {
+      lodepng_state_init(&state);
+      configure(&state, mode, 0, LFS_ZERO, 0);
+      error = lodepng_decode(&out, &ow, &oh, &state, png, pngsize);
+      lodepng_state_cleanup(&state);
+    }
+    if(error || ow != w || oh != h || memcmp(out, image.data(), image.size())) {
+      fprintf(stderr, "case %d: %s %s %s %ux%u did not round trip (error %u)\n", c, mode.name,
+              interlace ? "adam7" : "plain", strategy_names[s], w, h, error);
+      ++failures;
+    }
+    printf("%d %s %u %s %ux%u %u %zu %llx %llx\n", c, mode.name, interlace, strategy_names[s], w, h, error, pngsize,
+           error ? 0ull : fnv1a(png, pngsize), error ? 0ull : fnv1a(out, image.size()));
+    free(png);
+    free(out);
+  }
+
+  return failures ? 1 : 0;
+}
+
+int time_decode(unsigned size, int iterations) {
+  std::mt19937_64 rng(1);
+  printf("%ux%u, %d decodes each\n", size, size, iterations);
+  for(size_t m = 0; m != 2; ++m) {
+    const color_mode& mode = modes[m];
+    size_t pixel = mode.channels * mode.bitdepth / 8;
+    /* the gradient shape, so the decode is not all inflate */
+    bytes image((size_t)size * size * pixel);
+    for(size_t i = 0; i != image.size(); ++i) {
+      unsigned noise = rng() % 5;
+      image[i] = (unsigned char)((i / pixel) * 3 + (i % pixel) * 40 + noise);
+    }
+    for(unsigned filter = 0; filter != 5; ++filter) {
+      bytes predefined(size, (unsigned char)filter);
+      LodePNGState state;
+      lodepng_state_init(&state);
+      configure(&state, mode, 0, LFS_PREDEFINED, predefined.data());
+      unsigned char* png = 0;
+      size_t pngsize = 0;
+      unsigned error = lodepng_encode(&png, &pngsize, image.data(), size, size, &state);
+      lodepng_state_cleanup(&state);
+      if(error) {
+        fprintf(stderr, "%s filter %u: encode error %u\n", mode.name, filter, error);
+        free(png);
+        return 1;
+      }
+
+      std::vector<double> samples;
+      for(int i = 0; i != iterations; ++i) {
+        unsigned char* out = 0;
+        unsigned w = 0, h = 0;
+        lodepng_state_init(&state);
+        configure(&state, mode, 0, LFS_ZERO, 0);
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        error = lodepng_decode(&out, &w, &h, &state, png, pngsize);
+        samples.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        lodepng_state_cleanup(&state);
+        free(out);
+        if(error) {
+          fprintf(stderr, "%s filter %u: decode error %u\n", mode.name, filter, error);
+          free(png);
+          return 1;
+        }
+      }
+      free(png);
+      double best = samples[0];
+      for(size_t i = 1; i != samples.size(); ++i) if(samples[i] < best) best = samples[i];
+      printf("%-6s filter %u  best %8.2f ms\n", mode.name, filter, best);
+    }
+  }
+  return 0;
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+  if(argc > 1 && strcmp(argv[1], "--time") == 0) {
+    int size = argc > 2 ? atoi(argv[2]) : 2048;
+    int iterations = argc > 3 ? atoi(argv[3]) : 10;
+    return time_decode(size > 0 ? (unsigned)size : 1, iterations > 0 ? iterations : 1);
+  }
+  int cases = argc > 1 ? atoi(argv[1]) : 2000;
+  return compare(cases, argc > 2 ? strtoull(argv[2], 0, 10) : 12345);
+}
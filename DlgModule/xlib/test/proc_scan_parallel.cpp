@@ -0,0 +1,110 @@
+/*
+Serial against parallel process scans.
+
+Times ngs::xproc::proc_id_from_exe and proc_id_from_cwd first with
+proc_scan_set_thread_count(1) and then with the requested number of threads,
+and checks that both settings give the same process ids in the same order.
+To give the scans something to find, the program starts a few children of
+itself that share its executable and working directory and wait on a pipe.
+
+From the repository root:
+
+  g++ -O2 -std=c++17 -IDlgModule/xlib DlgModule/xlib/test/proc_scan_parallel.cpp \
+    DlgModule/xlib/lib/xproc/xproc.cpp -lpthread -o proc_scan_parallel
+  ./proc_scan_parallel 8 50
+
+More processes make the difference clearer; the children argument adds them.
+
+Usage: proc_scan_parallel [threads [iterations [children]]], the hardware
+concurrency (at least 2), 50 and 16 by default.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <limits.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "lib/xproc/xproc.hpp"
+
+namespace {
+
+typedef std::vector<ngs::xproc::PROCID> proc_ids;
+
+struct timing {
+  double median_ms;
+  proc_ids result;
+};
+
+timing measure(int threads, int iterations, const std::function<proc_ids()> &scan) {
+  ngs::xproc::proc_scan_set_thread_count(threads);
+  std::vector<double> samples;
+  timing t;
+  for (int i = 0; i < iterations; i++) {
+    auto start = std::chrono::steady_clock::now();
+    proc_ids result = scan();
+    samples.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    if (i == 0) t.result = result;
+    else if (result != t.result) t.result.clear();
+  }
+  std::sort(samples.begin(), samples.end());
+  t.median_ms = samples[samples.size() / 2];
+  return t;
+}
+
+bool compare(const char *name, int threads, int iterations, const std::function<proc_ids()> &scan) {
+  timing serial = measure(1, iterations, scan);
+  timing parallel = measure(threads, iterations, scan);
+  bool same = !serial.result.empty() && serial.result == parallel.result;
+  printf("%-16s %zu matches  1 thread %8.3f ms  %d threads %8.3f ms  %s\n", name, serial.result.size(),
+    serial.median_ms, threads, parallel.median_ms, same ? "same order" : "MISMATCH");
+  return same;
+}
+
+} // anonymous namespace
+
+int main(int argc, char **argv) {
+  int threads = argc > 1 ? atoi(argv[1]) : (int)std::thread::hardware_concurrency();
+  int iterations = argc > 2 ? atoi(argv[2]) : 50;
+  int children = argc > 3 ? atoi(argv[3]) : 16;
+  if (threads < 2) threads = 2;
+  if (iterations < 1) iterations = 1;
+
+  // the children block reading a pipe until it is closed, then exit.
+  int fd[2];
+  if (pipe(fd) != 0) {
+    perror("pipe");
+    return 1;
+  }
+  std::vector<pid_t> pids;
+  for (int i = 0; i < children; i++) {
+    pid_t pid = fork();
+    if (pid == 0) {
+      close(fd[1]);
+      char c;
+      while (read(fd[0], &c, 1) > 0);
+      _exit(0);
+    }
+    if (pid > 0) pids.push_back(pid);
+  }
+  close(fd[0]);
+
+  std::string exe = ngs::xproc::exe_from_proc_id(getpid());
+  std::string cwd = ngs::xproc::cwd_from_proc_id(getpid());
+  printf("%zu processes, exe %s, cwd %s\n", ngs::xproc::proc_id_enum().size(), exe.c_str(), cwd.c_str());
+
+  bool ok = true;
+  ok &= compare("proc_id_from_exe", threads, iterations, [&]() { return ngs::xproc::proc_id_from_exe(exe); });
+  ok &= compare("proc_id_from_cwd", threads, iterations, [&]() { return ngs::xproc::proc_id_from_cwd(cwd); });
+
+  close(fd[1]);
+  for (pid_t pid : pids) waitpid(pid, nullptr, 0);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,135 @@
+/*
+Dialog round trip latency for the xlib backend.
+
+show_message runs zenity and waits for it in create_shell_dialog. This program
+puts a symlink to itself named zenity first on PATH. Started under that name,
+it writes the time to a stamp file and exits at once, standing in for a dialog
+the user closes immediately. The program then reports how long show_message
+took to return after the stub exited, and the whole round trip.
+
+From the repository root:
+
+  g++ -O2 -std=c++17 -DPROCESS_GUIWINDOW_IMPL -IDlgModule/xlib DlgModule/xlib/test/shell_dialog_latency.cpp \
+    DlgModule/Universal/dlgmodule.cpp DlgModule/xlib/dlgmodule.cpp $(find DlgModule/xlib/lib -name '*.cpp') DlgModule/xlib/lodepng.cpp \
+    -lX11 -lpthread -o shell_dialog_latency
+  ./shell_dialog_latency 200
+
+For the numbers from before completion was event driven, run the same command
+in a worktree of the commit before it ("git worktree add ../before 5efd9cb^").
+That version opens an X display on every poll, so it needs DISPLAY set (Xvfb
+is enough), and newer compilers need -include math.h for its unqualified isnan.
+
+Usage: shell_dialog_latency [iterations], 200 by default.
+*/
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <limits.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+extern "C" double show_message(char *str);
+extern "C" double widget_set_system(char *sys);
+
+namespace {
+
+long long now_ns() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000ll + ts.tv_nsec;
+}
+
+// the stub dialog: record when it exits, print nothing, succeed.
+int stub_dialog() {
+  const char *stamp = getenv("SHELL_DIALOG_LATENCY_STAMP");
+  if (stamp) {
+    FILE *file = fopen(stamp, "w");
+    if (file) {
+      fprintf(file, "%lld\n", now_ns());
+      fclose(file);
+    }
+  }
+  return 0;
+}
+
+long long read_stamp(const std::string &path) {
+  long long stamp = 0;
+  FILE *file = fopen(path.c_str(), "r");
+  if (!file) return 0;
+  if (fscanf(file, "%lld", &stamp) != 1) stamp = 0;
+  fclose(file);
+  return stamp;
+}
+
+void report(const char *name, std::vector<long long> &samples) {
+  std::sort(samples.begin(), samples.end());
+  long long total = 0;
+  for (long long sample : samples) total += sample;
+  std::size_t n = samples.size();
+  printf("%-16s mean %8.3f ms  median %8.3f ms  p90 %8.3f ms  max %8.3f ms\n", name,
+    total / (double)n / 1e6, samples[n / 2] / 1e6, samples[n * 9 / 10] / 1e6, samples[n - 1] / 1e6);
+}
+
+} // anonymous namespace
+
+int main(int argc, char **argv) {
+  const char *base = strrchr(argv[0], '/');
+  base = base ? base + 1 : argv[0];
+  if (strcmp(base, "zenity") == 0) return stub_dialog();
+
+  int iterations = argc > 1 ? atoi(argv[1]) : 200;
+  if (iterations < 1) iterations = 1;
+
+  char self[PATH_MAX];
+  ssize_t length = readlink("/proc/self/exe", self, sizeof(self) - 1);
+  if (length <= 0) {
+    fprintf(stderr, "cannot find this executable\n");
+    return 1;
+  }
+  self[length] = '\0';
+  char dir[] = "/tmp/shell_dialog_latency.XXXXXX";
+  if (!mkdtemp(dir)) {
+    perror("mkdtemp");
+    return 1;
+  }
+  std::string stub = std::string(dir) + "/zenity";
+  std::string stamp = std::string(dir) + "/stamp";
+  if (symlink(self, stub.c_str()) != 0) {
+    perror("symlink");
+    return 1;
+  }
+  const char *path = getenv("PATH");
+  setenv("PATH", (std::string(dir) + ":" + (path ? path : "/usr/bin:/bin")).c_str(), 1);
+  setenv("SHELL_DIALOG_LATENCY_STAMP", stamp.c_str(), 1);
+  widget_set_system((char *)"Zenity");
+
+  std::vector<long long> exit_to_return, round_trip;
+  for (int i = 0; i < iterations; i++) {
+    unlink(stamp.c_str());
+    long long start = now_ns();
+    show_message((char *)"latency");
+    long long end = now_ns();
+    long long exited = read_stamp(stamp);
+    if (!exited) {
+      fprintf(stderr, "the stub dialog did not run\n");
+      return 1;
+    }
+    exit_to_return.push_back(end - exited);
+    round_trip.push_back(end - start);
+  }
+
+  printf("%d dialogs\n", iterations);
+  report("exit to return", exit_to_return);
+  report("round trip", round_trip);
+
+  unlink(stamp.c_str());
+  unlink(stub.c_str());
+  rmdir(dir);
+  return 0;
+}
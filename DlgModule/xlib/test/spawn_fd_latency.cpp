@@ -0,0 +1,140 @@
+/*
+Spawn latency with many open descriptors.
+
+Opens the requested number of descriptors, then forks and execs a child in a
+loop, sanitizing the child's descriptor table three ways:
+
+  close_fds_from   ngs::xproc::close_fds_from(3), as cproc and the xlib
+                   dialogs do
+  fixed loop       close(3..4095) one at a time, as before; descriptors above
+                   4095 leak into the child
+  rlimit loop      close(3..RLIMIT_NOFILE) one at a time
+
+The child is this program again, which exits with the number of descriptors
+above 2 it inherited (at most 254), so leaks show up next to the timings.
+
+From the repository root:
+
+  g++ -O2 -std=c++17 -IDlgModule/xlib DlgModule/xlib/test/spawn_fd_latency.cpp \
+    DlgModule/xlib/lib/xproc/xproc.cpp -lpthread -o spawn_fd_latency
+  ./spawn_fd_latency 1000 && ./spawn_fd_latency 64000
+
+The second run needs a hard RLIMIT_NOFILE above 64000 (ulimit -Hn); the
+program raises the soft limit itself and says so when it cannot.
+
+Usage: spawn_fd_latency [open descriptors [spawns]], 1000 and 200 by default.
+*/
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "lib/xproc/xproc.hpp"
+
+namespace {
+
+enum { sanitize_close_fds_from, sanitize_fixed_loop, sanitize_rlimit_loop };
+
+long long now_ns() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000ll + ts.tv_nsec;
+}
+
+// the child side: report how many descriptors above stderr survived the exec.
+int count_inherited() {
+  DIR *dir = opendir("/proc/self/fd");
+  if (!dir) return 255;
+  int self = dirfd(dir), count = 0;
+  while (dirent *entry = readdir(dir)) {
+    int fd = atoi(entry->d_name);
+    if (entry->d_name[0] != '.' && fd > 2 && fd != self) count++;
+  }
+  closedir(dir);
+  return std::min(count, 254);
+}
+
+int spawn(const char *self, int sanitize, rlim_t limit) {
+  pid_t pid = fork();
+  if (pid == 0) {
+    if (sanitize == sanitize_close_fds_from) {
+      ngs::xproc::close_fds_from(3);
+    } else {
+      int last = (sanitize == sanitize_fixed_loop) ? 4095 : (int)limit - 1;
+      for (int fd = 3; fd <= last; fd++) close(fd);
+    }
+    execl(self, self, "--count-inherited", (char *)nullptr);
+    _exit(255);
+  }
+  if (pid < 0) return -1;
+  int status = 0;
+  while (waitpid(pid, &status, 0) == -1 && errno == EINTR);
+  return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+} // anonymous namespace
+
+int main(int argc, char **argv) {
+  if (argc > 1 && strcmp(argv[1], "--count-inherited") == 0) return count_inherited();
+
+  int wanted = argc > 1 ? atoi(argv[1]) : 1000;
+  int spawns = argc > 2 ? atoi(argv[2]) : 200;
+  if (spawns < 1) spawns = 1;
+
+  rlimit limit;
+  getrlimit(RLIMIT_NOFILE, &limit);
+  rlim_t needed = (rlim_t)wanted + 16;
+  if (limit.rlim_cur < needed) {
+    limit.rlim_cur = std::min(needed, limit.rlim_max);
+    setrlimit(RLIMIT_NOFILE, &limit);
+    getrlimit(RLIMIT_NOFILE, &limit);
+  }
+  if (limit.rlim_cur < needed) {
+    fprintf(stderr, "RLIMIT_NOFILE is capped at %llu, opening fewer descriptors\n", (unsigned long long)limit.rlim_cur);
+    wanted = (int)limit.rlim_cur - 16;
+  }
+
+  // spread the descriptors over the whole table, up to the limit.
+  int devnull = open("/dev/null", O_RDONLY);
+  int opened = 1;
+  for (int i = 1; i < wanted; i++) {
+    int target = (int)((long long)i * ((long long)limit.rlim_cur - 8) / wanted) + 3;
+    if (fcntl(target, F_GETFD) != -1) continue;
+    if (dup2(devnull, target) == target) opened++;
+  }
+
+  char self[PATH_MAX];
+  ssize_t length = readlink("/proc/self/exe", self, sizeof(self) - 1);
+  if (length <= 0) {
+    fprintf(stderr, "cannot find this executable\n");
+    return 1;
+  }
+  self[length] = '\0';
+
+  printf("%d open descriptors, RLIMIT_NOFILE %llu, %d spawns each\n", opened, (unsigned long long)limit.rlim_cur, spawns);
+  const char *names[] = { "close_fds_from", "fixed loop", "rlimit loop" };
+  for (int sanitize = sanitize_close_fds_from; sanitize <= sanitize_rlimit_loop; sanitize++) {
+    std::vector<long long> samples;
+    int leaked = 0;
+    for (int i = 0; i < spawns; i++) {
+      long long start = now_ns();
+      leaked = spawn(self, sanitize, limit.rlim_cur);
+      samples.push_back(now_ns() - start);
+    }
+    std::sort(samples.begin(), samples.end());
+    printf("%-16s median %8.3f ms  p90 %8.3f ms  leaked %d\n", names[sanitize],
+      samples[samples.size() / 2] / 1e6, samples[samples.size() * 9 / 10] / 1e6, leaked);
+  }
+  return 0;
+}